@@ -1,9 +1,12 @@
 #pragma once
 
 #include "io/software_stack.hpp"
+#include "kaskas/core/allocation_tracker.hpp"
+#include "kaskas/events.hpp"
 #include "kaskas/io/hardware_stack.hpp"
 #include "kaskas/prompt/prompt.hpp"
 
+#include <magic_enum/magic_enum.hpp>
 #include <spine/eventsystem/eventsystem.hpp>
 
 namespace kaskas {
@@ -30,6 +33,11 @@ public:
     virtual void sideload_providers(io::VirtualStackFactory& ssf) { spn_assert(!"Virtual base function called"); }
 
 protected:
+    /// Attributes the heap allocations made while handling `event` to the event (native builds only)
+    static core::AllocationScope allocation_scope(const spn::core::Event& event) {
+        return core::AllocationScope("Event", magic_enum::enum_name(static_cast<Events>(event.id())));
+    }
+
     io::HardwareStack& _hws;
 
 private:
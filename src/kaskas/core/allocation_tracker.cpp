@@ -0,0 +1,25 @@
+#include "kaskas/core/allocation_tracker.hpp"
+
+#if defined(KASKAS_TRACK_ALLOCATIONS)
+
+#    include <cstdlib>
+#    include <new>
+
+// Replacements of the global operator new and delete may only be defined once, hence this translation unit. The array
+// and nothrow variants forward to these.
+
+void* operator new(std::size_t size) {
+    kaskas::core::AllocationTracker::on_allocation(size);
+    if (auto ptr = std::malloc(size > 0 ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept {
+    if (!ptr) return;
+    kaskas::core::AllocationTracker::on_deallocation();
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept { operator delete(ptr); }
+
+#endif
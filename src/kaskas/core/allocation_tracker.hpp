@@ -0,0 +1,141 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdio>
+#include <string_view>
+
+// Allocations are tracked on native builds only, where global operator new and delete are replaced (see
+// allocation_tracker.cpp). This holds for every native build, the `native` firmware environment as much as the unit
+// tests; define KASKAS_NO_ALLOCATION_TRACKING to keep the toolchain's operator new. AddressSanitizer replaces them as
+// well, so sanitized builds are not tracked (GCC defines __SANITIZE_ADDRESS__, Clang reports it as a feature).
+#if defined(__SANITIZE_ADDRESS__)
+#    define KASKAS_ADDRESS_SANITIZER
+#elif defined(__has_feature)
+#    if __has_feature(address_sanitizer)
+#        define KASKAS_ADDRESS_SANITIZER
+#    endif
+#endif
+
+#if defined(NATIVE) && !defined(KASKAS_ADDRESS_SANITIZER) && !defined(KASKAS_NO_ALLOCATION_TRACKING)
+#    define KASKAS_TRACK_ALLOCATIONS
+#endif
+
+namespace kaskas::core {
+
+/// Heap allocation statistics
+struct AllocationStats {
+    size_t allocations = 0;
+    size_t deallocations = 0;
+    size_t bytes = 0; // bytes allocated
+};
+
+/// The heap allocation statistics of everything executed under a label
+struct LabelledAllocationStats {
+    static constexpr size_t max_label_size = 40;
+
+    std::array<char, max_label_size> label_storage{};
+    size_t label_size = 0;
+    AllocationStats stats;
+
+    std::string_view label() const { return std::string_view(label_storage.data(), label_size); }
+};
+
+/// Counts heap allocations, attributing them to the innermost open `AllocationScope`; for example the RPC model, event
+/// handler or peripheral update being executed. On target nothing is counted.
+class AllocationTracker {
+public:
+#if defined(KASKAS_TRACK_ALLOCATIONS)
+    static constexpr bool is_enabled = true;
+#else
+    static constexpr bool is_enabled = false;
+#endif
+    static constexpr size_t max_scopes = 48; // allocations in scopes beyond are only counted in the total
+    using Scope = LabelledAllocationStats;
+
+    static void on_allocation(size_t size) {
+        count_allocation(_total, size);
+        if (_current) count_allocation(_current->stats, size);
+    }
+
+    static void on_deallocation() {
+        ++_total.deallocations;
+        if (_current) ++_current->stats.deallocations;
+    }
+
+    /// Returns the statistics of all allocations, whether attributed to a scope or not
+    static const AllocationStats& total() { return _total; }
+
+    /// Returns the scope with the provided label, or nullptr if nothing was executed under that label.
+    static const Scope* find(const std::string_view& label) {
+        for (size_t i = 0; i < _scope_count; ++i) {
+            if (_scopes[i].label() == label) return &_scopes[i];
+        }
+        return nullptr;
+    }
+
+    static size_t scope_count() { return _scope_count; }
+    static const Scope& scope(size_t i) { return _scopes[i]; }
+
+    /// Zeroes all statistics. Labels are kept, as a scope may be open.
+    static void reset() {
+        _total = {};
+        for (size_t i = 0; i < _scope_count; ++i)
+            _scopes[i].stats = {};
+    }
+
+private:
+    static void count_allocation(AllocationStats& stats, size_t size) {
+        ++stats.allocations;
+        stats.bytes += size;
+    }
+
+    /// Returns the scope with the provided label, claiming one if it is new. Returns nullptr when all scopes are taken.
+    static Scope* open(const std::string_view& label) {
+        if (const auto scope = find(label)) return const_cast<Scope*>(scope);
+        if (_scope_count == max_scopes) return nullptr;
+        auto& scope = _scopes[_scope_count++];
+        scope.label_size = label.copy(scope.label_storage.data(), scope.label_storage.size());
+        return &scope;
+    }
+
+    inline static AllocationStats _total;
+    inline static std::array<Scope, max_scopes> _scopes{};
+    inline static size_t _scope_count = 0;
+    inline static Scope* _current = nullptr;
+
+    friend class AllocationScope;
+};
+
+/// Attributes the heap allocations made during its lifetime to the label `first:second#index`, such as `MOC:foo` for
+/// an RPC or `Peripheral#3` for a peripheral update. The second part and the index are optional.
+class AllocationScope {
+public:
+    explicit AllocationScope(const std::string_view& first, const std::string_view& second = {}, int index = -1) {
+#if defined(KASKAS_TRACK_ALLOCATIONS)
+        std::array<char, LabelledAllocationStats::max_label_size> label{};
+        int size = std::snprintf(label.data(), label.size(), "%.*s%s%.*s", static_cast<int>(first.size()),
+                                 first.data(), second.empty() ? "" : ":", static_cast<int>(second.size()),
+                                 second.data());
+        if (index >= 0 && size >= 0 && size < static_cast<int>(label.size())) {
+            size += std::snprintf(label.data() + size, label.size() - size, "#%i", index);
+        }
+        size = size < 0 ? 0 : std::min(size, static_cast<int>(label.size()) - 1);
+
+        _previous = AllocationTracker::_current;
+        AllocationTracker::_current = AllocationTracker::open(std::string_view(label.data(), size));
+#endif
+    }
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+#if defined(KASKAS_TRACK_ALLOCATIONS)
+    ~AllocationScope() { AllocationTracker::_current = _previous; }
+
+private:
+    AllocationTracker::Scope* _previous = nullptr;
+#endif
+};
+
+} // namespace kaskas::core
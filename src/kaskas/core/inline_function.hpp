@@ -0,0 +1,93 @@
+#pragma once
+
+#include <spine/core/debugging.hpp>
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace kaskas::core {
+
+template<typename Signature, size_t Capacity = 2 * sizeof(void*)>
+class InlineFunction;
+
+/// A copyable, type-erased callable in the spirit of `std::function`, whose target is always stored inline. The
+/// capacity is fixed at compile time; assigning a callable that does not fit fails to compile instead of falling back
+/// to the heap.
+template<typename R, typename... Args, size_t Capacity>
+class InlineFunction<R(Args...), Capacity> {
+public:
+    static constexpr size_t capacity = Capacity;
+
+    InlineFunction() = default;
+    InlineFunction(std::nullptr_t) {}
+
+    template<typename F, typename Fn = std::decay_t<F>,
+             typename = std::enable_if_t<!std::is_same_v<Fn, InlineFunction> && std::is_invocable_r_v<R, Fn&, Args...>>>
+    InlineFunction(F&& f) {
+        static_assert(sizeof(Fn) <= Capacity, "InlineFunction: the callable's captures do not fit the inline storage");
+        static_assert(alignof(Fn) <= alignof(std::max_align_t), "InlineFunction: the callable is overaligned");
+        static_assert(std::is_copy_constructible_v<Fn>, "InlineFunction: the callable must be copy constructible");
+        ::new (static_cast<void*>(_storage)) Fn(std::forward<F>(f));
+        _ops = &ops_for<Fn>;
+    }
+
+    InlineFunction(const InlineFunction& other) : _ops(other._ops) {
+        if (_ops) _ops->copy(_storage, other._storage);
+    }
+    InlineFunction(InlineFunction&& other) noexcept : _ops(other._ops) {
+        if (_ops) _ops->move(_storage, other._storage);
+    }
+
+    InlineFunction& operator=(const InlineFunction& other) {
+        if (this == &other) return *this;
+        reset();
+        _ops = other._ops;
+        if (_ops) _ops->copy(_storage, other._storage);
+        return *this;
+    }
+    InlineFunction& operator=(InlineFunction&& other) noexcept {
+        if (this == &other) return *this;
+        reset();
+        _ops = other._ops;
+        if (_ops) _ops->move(_storage, other._storage);
+        return *this;
+    }
+
+    ~InlineFunction() { reset(); }
+
+    R operator()(Args... args) const {
+        spn_assert(_ops);
+        return _ops->invoke(_storage, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const { return _ops != nullptr; }
+
+private:
+    struct Ops {
+        R (*invoke)(void* storage, Args&&... args);
+        void (*copy)(void* dst, const void* src);
+        void (*move)(void* dst, void* src);
+        void (*destroy)(void* storage);
+    };
+
+    template<typename Fn>
+    static constexpr Ops ops_for = {
+        [](void* storage, Args&&... args) -> R { return (*static_cast<Fn*>(storage))(std::forward<Args>(args)...); },
+        [](void* dst, const void* src) { ::new (dst) Fn(*static_cast<const Fn*>(src)); },
+        [](void* dst, void* src) { ::new (dst) Fn(std::move(*static_cast<Fn*>(src))); },
+        [](void* storage) { static_cast<Fn*>(storage)->~Fn(); },
+    };
+
+    void reset() {
+        if (_ops) _ops->destroy(_storage);
+        _ops = nullptr;
+    }
+
+    // like `std::function`, a const call may invoke a mutable target
+    alignas(std::max_align_t) mutable unsigned char _storage[Capacity] = {};
+    const Ops* _ops = nullptr;
+};
+
+} // namespace kaskas::core
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <spine/core/debugging.hpp>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace kaskas::core {
+
+/// A fixed amount of preallocated slots, in which objects of type `T` are constructed and destroyed without touching
+/// the heap. Objects are handed out as `Pooled<T>`, a `std::unique_ptr` that returns its slot to the pool. When every
+/// slot is taken an object is allocated on the heap instead, and counted as an overflow; a pool sized to its peak use
+/// thus never allocates after it is reserved.
+///
+/// The pool must outlive the objects it hands out, and is neither copied nor moved.
+template<typename T>
+class ObjectPool {
+public:
+    /// Destroys a pooled object and returns its slot, or deletes an object allocated on the heap.
+    struct Release {
+        Release() = default;
+        Release(std::default_delete<T>) {} // adopts plain heap objects
+        explicit Release(ObjectPool* pool) : pool(pool) {}
+
+        void operator()(T* object) const {
+            if (pool) pool->release(object);
+            else delete object;
+        }
+
+        ObjectPool* pool = nullptr; // null for objects allocated on the heap
+    };
+    using Handle = std::unique_ptr<T, Release>;
+
+    explicit ObjectPool(size_t capacity = 0) { reserve(capacity); }
+    ObjectPool(const ObjectPool&) = delete;
+    ObjectPool& operator=(const ObjectPool&) = delete;
+    ~ObjectPool() { spn_assert(_in_use == 0); }
+
+    /// Replaces the slots with `capacity` new ones. Expects no object to be in use.
+    void reserve(size_t capacity) {
+        spn_expect(_in_use == 0);
+        _slots = capacity > 0 ? std::make_unique<Slot[]>(capacity) : nullptr;
+        _capacity = capacity;
+        _free = nullptr;
+        for (size_t i = capacity; i > 0; --i) {
+            _slots[i - 1].next = _free;
+            _free = &_slots[i - 1];
+        }
+    }
+
+    /// Constructs an object from `args` in a free slot, or on the heap when every slot is taken.
+    template<typename... Args>
+    Handle acquire(Args&&... args) {
+        if (!_free) {
+            ++_overflows;
+            return Handle(new T(std::forward<Args>(args)...), Release());
+        }
+        auto slot = _free;
+        auto object = ::new (static_cast<void*>(slot->storage)) T(std::forward<Args>(args)...);
+        _free = slot->next;
+        _high_water = std::max(_high_water, ++_in_use);
+        return Handle(object, Release(this));
+    }
+
+    size_t capacity() const { return _capacity; }
+    size_t in_use() const { return _in_use; } // objects in slots; overflowing objects are not counted
+    size_t high_water() const { return _high_water; }
+    size_t overflows() const { return _overflows; } // objects allocated on the heap since the pool was made
+
+private:
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)]; // first, so that an object's address is its slot's
+        Slot* next;
+    };
+
+    void release(T* object) {
+        object->~T();
+        auto slot = reinterpret_cast<Slot*>(object);
+        slot->next = _free;
+        _free = slot;
+        --_in_use;
+    }
+
+    std::unique_ptr<Slot[]> _slots;
+    size_t _capacity = 0;
+    Slot* _free = nullptr; // the free slots, linked through `Slot::next`
+    size_t _in_use = 0;
+    size_t _high_water = 0;
+    size_t _overflows = 0;
+};
+
+/// An object owned by an `ObjectPool`, or by the heap
+template<typename T>
+using Pooled = typename ObjectPool<T>::Handle;
+
+} // namespace kaskas::core
@@ -11,6 +11,7 @@ enum class Events {
     UIButtonCheck,
     UIWatchDog,
     UIPromptFollowUp,
+    UIPromptLineReady,
     SensorFollowUp,
     OutOfWater,
     VentilationFollowUp,
@@ -36,6 +37,7 @@ enum class Events {
     LightBroadSpectrumTurnOff,
     DAQWarmedUp,
     DAQTainted,
+    DAQPublish,
     Size
 };
 }; // namespace kaskas
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "kaskas/core/allocation_tracker.hpp"
 #include "kaskas/io/peripheral.hpp"
 #include "kaskas/io/provider.hpp"
 #include "kaskas/io/providers/analogue.hpp"
@@ -48,8 +49,10 @@ public:
 
     /// Update all peripherals that need an update, respecting the peripheral's `sampling_time`
     void update_all() {
-        for (auto& p : _peripherals) {
+        for (size_t i = 0; i < _peripherals.size(); ++i) {
+            auto& p = _peripherals[i];
             if (p && p->needs_update()) {
+                const auto allocations = core::AllocationScope("Peripheral", {}, static_cast<int>(i));
                 p->update();
             }
         }
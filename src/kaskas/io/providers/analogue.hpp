@@ -1,17 +1,18 @@
 #pragma once
 
+#include "kaskas/core/inline_function.hpp"
 #include "kaskas/io/provider.hpp"
 
 #include <magic_enum/magic_enum.hpp>
 #include <spine/core/debugging.hpp>
 
-#include <functional>
-
 namespace kaskas::io {
 /// a provider for any sensor that provides a single fp voltage
 class AnalogueSensor : public Provider {
 public:
-    AnalogueSensor(const std::function<float()>& value_f) : _value_f(value_f){};
+    using ValueFunction = core::InlineFunction<float()>;
+
+    AnalogueSensor(const ValueFunction& value_f) : _value_f(value_f){};
 
     float value() const { return _value_f(); }
 
@@ -27,18 +28,18 @@ public:
     }
 
 private:
-    const std::function<float()> _value_f;
+    const ValueFunction _value_f;
 };
 
 /// a provider for any actuator that needs a single fp voltage
 class AnalogueActuator : public Provider {
 public:
     struct FunctionMap {
-        const std::function<float()> value_f;
-        const std::function<void(float)> set_value_f;
-        const std::function<void(float, float, k_time_ms)> fade_to_f;
-        const std::function<void(float, k_time_ms)> creep_to_f;
-        const std::function<void()> creep_stop_f;
+        const core::InlineFunction<float()> value_f;
+        const core::InlineFunction<void(float)> set_value_f;
+        const core::InlineFunction<void(float, float, k_time_ms)> fade_to_f;
+        const core::InlineFunction<void(float, k_time_ms)> creep_to_f;
+        const core::InlineFunction<void()> creep_stop_f;
     };
 
     AnalogueActuator(const FunctionMap& map) : _map(map){};
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "kaskas/core/inline_function.hpp"
 #include "kaskas/io/provider.hpp"
 
 #include <spine/core/debugging.hpp>
@@ -14,10 +15,10 @@ public:
     using UnixTime = time_t;
 
     struct FunctionMap {
-        const std::function<DateTime()> now_f;
-        const std::function<void(DateTime)> settime_f;
-        const std::function<UnixTime()> epoch_f;
-        const std::function<bool()> isready_f;
+        const core::InlineFunction<DateTime()> now_f;
+        const core::InlineFunction<void(DateTime)> settime_f;
+        const core::InlineFunction<UnixTime()> epoch_f;
+        const core::InlineFunction<bool()> isready_f;
     };
 
     Clock(const FunctionMap&& map) : _map(std::move(map)) {}
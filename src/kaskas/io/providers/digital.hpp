@@ -1,19 +1,19 @@
 #pragma once
 
+#include "kaskas/core/inline_function.hpp"
 #include "kaskas/io/provider.hpp"
 
 #include <magic_enum/magic_enum.hpp>
 #include <spine/core/types.hpp>
 
-#include <functional>
-
 namespace kaskas::io {
 /// a provider for any datasource that provides a single logic level
 class DigitalSensor : public Provider {
 public:
     using LogicalState = spn::core::LogicalState;
+    using ValueFunction = core::InlineFunction<LogicalState()>;
 
-    DigitalSensor(const std::function<LogicalState()>& value_f) : _value_f(value_f){};
+    DigitalSensor(const ValueFunction& value_f) : _value_f(value_f){};
 
     LogicalState state() const { return _value_f(); }
     float value() const { return _value_f(); }
@@ -30,7 +30,7 @@ public:
     }
 
 private:
-    const std::function<LogicalState()> _value_f;
+    const ValueFunction _value_f;
 };
 
 /// a provider for any actuator that needs a single logic level
@@ -39,8 +39,8 @@ public:
     using LogicalState = spn::core::LogicalState;
 
     struct FunctionMap {
-        const std::function<LogicalState()> state_f;
-        const std::function<void(LogicalState)> set_state_f;
+        const core::InlineFunction<LogicalState()> state_f;
+        const core::InlineFunction<void(LogicalState)> set_state_f;
     };
 
     DigitalActuator(const FunctionMap& map) : _map(map){};
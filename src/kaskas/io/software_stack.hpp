@@ -34,7 +34,8 @@ public:
         Idx max_providers = 16;
     };
 
-    VirtualStack(const Config&& cfg) : _providers(cfg.max_providers), _cfg(std::move(cfg)) {}
+    VirtualStack(const Config&& cfg)
+        : _providers(cfg.max_providers), _rpc_cookbook({.max_recipes = cfg.max_providers}), _cfg(std::move(cfg)) {}
 
 public:
     const std::string_view& alias() const { return _cfg.alias; }
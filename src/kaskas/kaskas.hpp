@@ -7,6 +7,7 @@
 #include "kaskas/io/peripherals/relay.hpp"
 #include "kaskas/io/providers/clock.hpp"
 #include "kaskas/prompt/datalink.hpp"
+#include "kaskas/prompt/interrupt_stream.hpp"
 #include "kaskas/prompt/prompt.hpp"
 #include "kaskas/prompt/rpc/cookbook.hpp"
 #include "kaskas/subsystems/climatecontrol.hpp"
@@ -49,13 +50,27 @@ public:
           _components(std::vector<std::unique_ptr<Component>>()) {
         if (_cfg.prompt_cfg) {
             auto uart = std::make_shared<HAL::UART>(HAL::UART::Config{.stream = &Serial, .timeout = k_time_ms(50)});
+            using prompt::InterruptStream;
+            _uart = std::make_shared<InterruptStream>(
+                uart, InterruptStream::Config{.rx_buffer_size = _cfg.prompt_cfg->io_buffer_size,
+                                              .delimiters = _cfg.prompt_cfg->line_delimiters,
+                                              .tx_buffer_size = _cfg.prompt_cfg->io_buffer_size,
+                                              .baud_rate = 115200, // as opened by the HAL; see `monitor_speed`
+                                              .max_baud_rate = 921600,
+                                              .switch_baud_rate = [](uint32_t baud_rate) {
+                                                  Serial.flush(); // let the last byte at the former rate out
+                                                  Serial.begin(baud_rate);
+                                              }});
             using prompt::Datalink;
-            auto dl =
-                std::make_shared<Datalink>(uart, Datalink::Config{.input_buffer_size = _cfg.prompt_cfg->io_buffer_size,
-                                                                  .output_buffer_size = _cfg.prompt_cfg->io_buffer_size,
-                                                                  .delimiters = _cfg.prompt_cfg->line_delimiters});
+            auto dl = std::make_shared<Datalink>(
+                _uart, Datalink::Config{.input_buffer_size = _cfg.prompt_cfg->io_buffer_size,
+                                        .output_buffer_size = _cfg.prompt_cfg->io_buffer_size,
+                                        .delimiters = _cfg.prompt_cfg->line_delimiters});
+            _uart->attach_datalink(dl);
             _prompt = std::make_shared<Prompt>(std::move(*_cfg.prompt_cfg));
-            _prompt->hotload_datalink(std::move(dl));
+            _prompt->add_datalink(std::move(dl));
+            _prompt->set_stream_poller([uart = _uart]() { uart->poll(); }); // while an autotune blocks `loop()`
+            _prompt->hotload_rpc_recipe(_uart->rpc_recipe());
         }
     }
     KasKas(const KasKas& other) = delete;
@@ -112,6 +127,10 @@ public:
 
     int loop() {
         platform_sanity_checks();
+        if (_uart) {
+            _uart->poll(); // drains replies at the line's pace; never blocks
+            if (_uart->take_line_ready()) _evsys.trigger(Events::UIPromptLineReady);
+        }
         _evsys.loop();
         return 0;
     }
@@ -146,5 +165,6 @@ private:
     std::shared_ptr<io::HardwareStack> _hws;
     std::vector<std::unique_ptr<Component>> _components;
     std::shared_ptr<Prompt> _prompt;
+    std::shared_ptr<prompt::InterruptStream> _uart; // the prompt's UART, signalling complete lines
 };
 } // namespace kaskas
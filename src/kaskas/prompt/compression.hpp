@@ -0,0 +1,135 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace kaskas::prompt::compression {
+
+/// A small LZ77 dialect for the return values of text replies. Bytes below 0x80 are literals and are passed as is, so
+/// that a compressed value holds no line delimiter that its plain value did not hold:
+///   0x00-0x7F               a literal byte
+///   0x80-0xBD  distance     a copy of `code - 0x80 + MIN_MATCH` bytes, starting `distance - 0x80 + 1` bytes back;
+///                           a copy may overlap the bytes it produces
+///   0xFF       byte         a literal byte of 0x80 or above
+/// Any other code is invalid.
+constexpr size_t WINDOW_SIZE = 128; // how far back a copy may start
+constexpr size_t MIN_MATCH = 3;
+constexpr size_t MAX_MATCH = 64;
+constexpr uint8_t MATCH_CODE = 0x80;
+constexpr uint8_t LITERAL_CODE = 0xFF;
+
+/// Returns an upper bound of the compressed size of `size` bytes.
+constexpr size_t max_encoded_size(size_t size) { return 2 * size; }
+
+/// Compresses a value on the fly, with a fixed budget of RAM: a ring of the last `WINDOW_SIZE` bytes and a lookahead
+/// of up to `MAX_MATCH` bytes, which are held back until a copy cannot grow any longer. Matches are found by a search
+/// of the whole window, a byte compare per position for most positions.
+class Encoder {
+public:
+    /// Appends bytes to the value; `sink` is called with the compressed bytes as they become known.
+    template<typename Sink>
+    void put(const std::string_view& bytes, Sink&& sink) {
+        for (const auto c : bytes) {
+            _ring[_end++] = static_cast<uint8_t>(c);
+            if (++_lookahead == MAX_MATCH) put_token();
+            if (_out_size + 2 > _out.size()) flush(sink);
+        }
+        flush(sink);
+    }
+
+    /// Compresses the bytes held back and ends the value; the next value is compressed on its own.
+    template<typename Sink>
+    void finish(Sink&& sink) {
+        while (_lookahead > 0) {
+            put_token();
+            if (_out_size + 2 > _out.size()) flush(sink);
+        }
+        flush(sink);
+        _history = 0;
+    }
+
+    /// Returns an upper bound of the compressed size of the bytes held back.
+    size_t pending() const { return max_encoded_size(_lookahead); }
+
+private:
+    /// Compresses the first bytes of the lookahead into a single copy or literal
+    void put_token() {
+        size_t best_length = 0;
+        size_t best_distance = 0;
+        for (size_t distance = 1; distance <= _history; ++distance) {
+            const uint8_t from = _cursor - distance;
+            size_t length = 0;
+            while (length < _lookahead && _ring[uint8_t(from + length)] == _ring[uint8_t(_cursor + length)])
+                ++length;
+            if (length > best_length) {
+                best_length = length;
+                best_distance = distance;
+                if (length == _lookahead) break;
+            }
+        }
+
+        if (best_length >= MIN_MATCH) {
+            _out[_out_size++] = static_cast<char>(MATCH_CODE + best_length - MIN_MATCH);
+            _out[_out_size++] = static_cast<char>(MATCH_CODE + best_distance - 1);
+        } else {
+            best_length = 1;
+            const auto byte = _ring[_cursor];
+            if (byte >= MATCH_CODE) _out[_out_size++] = static_cast<char>(LITERAL_CODE);
+            _out[_out_size++] = static_cast<char>(byte);
+        }
+        _cursor += best_length;
+        _lookahead -= best_length;
+        _history = std::min(WINDOW_SIZE, _history + best_length);
+    }
+
+    template<typename Sink>
+    void flush(Sink& sink) {
+        if (_out_size == 0) return;
+        sink(std::string_view(_out.data(), _out_size));
+        _out_size = 0;
+    }
+
+    // the window and the lookahead share a ring, indexed modulo its size by wrapping 8-bit indices
+    static_assert(WINDOW_SIZE + MAX_MATCH <= 256);
+    std::array<uint8_t, 256> _ring{};
+    uint8_t _cursor = 0; // first byte of the lookahead
+    uint8_t _end = 0; // one past the last byte of the lookahead
+    size_t _lookahead = 0;
+    size_t _history = 0; // bytes before the cursor a copy may start from
+
+    std::array<char, 32> _out{}; // compressed bytes, passed to the sink in batches
+    size_t _out_size = 0;
+};
+
+/// Decompresses `encoded` into `out`, which holds `capacity` bytes. Returns the decompressed size, or nothing if the
+/// input is malformed or does not fit.
+inline std::optional<size_t> decode(const std::string_view& encoded, char* out, size_t capacity) {
+    size_t written = 0;
+    for (size_t read = 0; read < encoded.size();) {
+        const auto code = static_cast<uint8_t>(encoded[read++]);
+        if (code < MATCH_CODE || code == LITERAL_CODE) {
+            if (code == LITERAL_CODE) {
+                if (read == encoded.size() || static_cast<uint8_t>(encoded[read]) < MATCH_CODE) return std::nullopt;
+                ++read;
+            }
+            if (written == capacity) return std::nullopt;
+            out[written++] = encoded[read - 1];
+            continue;
+        }
+
+        const size_t length = code - MATCH_CODE + MIN_MATCH;
+        if (length > MAX_MATCH || read == encoded.size()) return std::nullopt;
+        const auto distance_code = static_cast<uint8_t>(encoded[read++]);
+        const size_t distance = distance_code - MATCH_CODE + 1;
+        if (distance_code < MATCH_CODE || distance > written || length > capacity - written) return std::nullopt;
+        for (size_t i = 0; i < length; ++i, ++written)
+            out[written] = out[written - distance];
+    }
+    return written;
+}
+
+} // namespace kaskas::prompt::compression
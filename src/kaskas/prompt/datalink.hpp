@@ -1,14 +1,110 @@
 #pragma once
 
+#include "kaskas/core/object_pool.hpp"
+#include "kaskas/prompt/compression.hpp"
+#include "kaskas/prompt/dialect.hpp"
+#include "kaskas/prompt/framing.hpp"
 #include "kaskas/prompt/message/incoming_message_factory.hpp"
 #include "kaskas/prompt/message/outgoing_message_factory.hpp"
+#include "kaskas/prompt/rpc/reply_writer.hpp"
 
 #include <spine/core/utils/string.hpp>
 #include <spine/io/stream/buffered_stream.hpp>
 #include <spine/io/stream/transaction.hpp>
+#include <spine/structure/time/timers.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <optional>
+#include <utility>
+#include <vector>
 
 namespace kaskas::prompt {
 
+namespace detail {
+
+/// Passes the bytes read from a stream through, counting the line delimiters among them. Every byte is scanned once,
+/// as it arrives, so that the buffered stream on top is only asked for a line once a delimiter has arrived.
+///
+/// A read passes at most a single line, up to and including its delimiters, and holds back the bytes following it.
+/// These may be meant for another dialect, negotiated by that line; see `take_held()`. The held bytes are kept in a
+/// ring of fixed capacity, which is never reallocated.
+class DelimiterCountingStream final : public spn::io::Stream {
+public:
+    static constexpr size_t max_read_size = 64; // bytes read from the stream at once, bounding the bytes held back
+
+    /// Holds up to `max_held` bytes, such as the unread part of a frame put back on a switch to text mode
+    DelimiterCountingStream(std::shared_ptr<spn::io::Stream> stream, const std::string_view& delimiters,
+                            size_t max_held)
+        : _stream(std::move(stream)), _held(std::max(max_held, max_read_size)) {
+        for (const auto c : delimiters)
+            _is_delimiter[static_cast<uint8_t>(c)] = true;
+    }
+
+    void initialize() override { _stream->initialize(); }
+
+    size_t read(uint8_t* buffer, size_t size) override {
+        size_t read = 0;
+        if (_held_size == 0) {
+            read = _stream->read(buffer, std::min(size, max_read_size));
+        } else {
+            read = take_held(buffer, size);
+        }
+
+        const auto is_delimiter = [this](uint8_t c) { return _is_delimiter[c]; };
+        const auto line_end = std::find_if_not(std::find_if(buffer, buffer + read, is_delimiter), buffer + read,
+                                               is_delimiter);
+        put_back(line_end, std::distance(line_end, buffer + read));
+        read = std::distance(buffer, line_end);
+
+        _delimiters += std::count_if(buffer, buffer + read, is_delimiter);
+        return read;
+    }
+
+    size_t write(const uint8_t* buffer, size_t size) override { return _stream->write(buffer, size); }
+    size_t available() const override { return _held_size + _stream->available(); }
+
+    /// Returns the amount of delimiters read and not yet taken; an upper bound to the lines in the buffer
+    size_t delimiters() const { return _delimiters; }
+    void take_delimiter() { _delimiters -= std::min<size_t>(_delimiters, 1); }
+    void clear_delimiters() { _delimiters = 0; }
+
+    /// Moves up to `size` of the bytes read from the stream but not yet passed on into `buffer`, which are no longer
+    /// held. Returns the amount of bytes moved.
+    size_t take_held(uint8_t* buffer, size_t size) {
+        const auto taken = std::min(size, _held_size);
+        const auto first = std::min(taken, _held.size() - _held_front);
+        std::copy_n(_held.data() + _held_front, first, buffer);
+        std::copy_n(_held.data(), taken - first, buffer + first);
+        _held_front = (_held_front + taken) % _held.size();
+        _held_size -= taken;
+        return taken;
+    }
+    size_t held() const { return _held_size; }
+    void clear_held() { _held_size = 0; }
+
+    /// Holds `bytes` in front of those held already, to be passed on before anything else
+    void put_back(const uint8_t* bytes, size_t size) {
+        spn_assert(_held_size + size <= _held.size());
+        _held_front = (_held_front + _held.size() - size) % _held.size();
+        const auto first = std::min(size, _held.size() - _held_front);
+        std::copy_n(bytes, first, _held.data() + _held_front);
+        std::copy_n(bytes + first, size - first, _held.data());
+        _held_size += size;
+    }
+
+private:
+    std::shared_ptr<spn::io::Stream> _stream;
+    std::array<bool, 256> _is_delimiter{};
+    size_t _delimiters = 0;
+    std::vector<uint8_t> _held; // ring of bytes read from the stream, following the last line passed on
+    size_t _held_front = 0;
+    size_t _held_size = 0;
+};
+
+} // namespace detail
+
 class Request {
 public:
 private:
@@ -21,9 +117,16 @@ public:
     using BufferedStream = spn::io::BufferedStream;
     using Config = BufferedStream::Config;
 
+    /// The dialect spoken over the link. Text is the default; binary is negotiated by the host.
+    enum class Mode { TEXT, BINARY };
+
 public:
     Datalink(std::shared_ptr<spn::io::Stream> stream, BufferedStream::Config&& cfg)
-        : _stream(std::move(stream), std::move(cfg)) {}
+        : _input_buffer_size(cfg.input_buffer_size), _output_buffer_size(cfg.output_buffer_size),
+          _line_delimiter(cfg.delimiters.empty() ? '\n' : cfg.delimiters.front()), _raw_stream(stream),
+          _scanner(std::make_shared<detail::DelimiterCountingStream>(std::move(stream), cfg.delimiters,
+                                                                     cfg.input_buffer_size)),
+          _stream(_scanner, std::move(cfg)) {}
 
     Datalink(std::shared_ptr<spn::io::Stream> stream, const BufferedStream::Config& cfg)
         : Datalink(std::move(stream), BufferedStream::Config(cfg)) {}
@@ -32,27 +135,187 @@ public:
     void initialize() {}
 
     /// Pull data into the buffer from the datalink's active stream (such as UART). Returns amount of bytes pulled from
-    /// stream.
-    size_t pull() { return _stream.pull_in_data(); }
+    /// stream. In text mode a single line is pulled at a time, and nothing while a switch of mode is pending: the
+    /// bytes following the line that requested the switch are meant for the new mode.
+    size_t pull() {
+        if (_mode == Mode::TEXT) return pull_line();
+
+        if (_binary_timeout > k_time_ms(0) && _since_last_frame.time_since_last(false) >= _binary_timeout) {
+            WARN("Datalink: no frame received in time, falling back to text");
+            set_mode(Mode::TEXT);
+            return pull_line();
+        }
+
+        // frames are read straight from the stream; the buffered stream would split them on its delimiters
+        const auto used = _rx_frame.size();
+        if (used >= _input_buffer_size) return 0;
+        _rx_frame.resize(_input_buffer_size);
+        const auto pulled = _raw_stream->read(_rx_frame.data() + used, _input_buffer_size - used);
+        _rx_frame.resize(used + pulled);
+        return pulled;
+    }
 
     /// Push data into the datalink's outgoing stream from the buffer. Returns amount of bytes pushed into stream.
-    size_t push() { return _stream.push_out_data(); }
+    size_t push() {
+        const auto pushed = _stream.push_out_data();
+        _tx_pending -= std::min(pushed, _tx_pending);
+        if (_pending_mode && _tx_pending == 0) {
+            set_mode(*_pending_mode);
+            _pending_mode.reset();
+        }
+        return pushed;
+    }
+
+    /// Switches to `mode` once everything written so far (such as the acknowledgement of the switch) is pushed out.
+    /// In binary mode the link falls back to text when no valid frame is received for `timeout`, unless it is zero.
+    void request_mode(Mode mode, k_time_ms timeout = k_time_ms(0)) {
+        _pending_mode = mode;
+        _binary_timeout = timeout;
+    }
+
+    Mode mode() const { return _mode; }
+
+    /// Drops the bytes received but not yet read, such as those received at a former baud rate. Expects no line or
+    /// message read from the link to be alive.
+    void discard_input() {
+        _scanner->clear_held();
+        _scanner->clear_delimiters();
+        if (_mode == Mode::BINARY) {
+            _rx_frame.clear();
+            _rx_consumed = 0;
+            return;
+        }
+
+        // terminates a partial line in the buffered stream, so that it is released with the lines before it
+        _scanner->put_back(reinterpret_cast<const uint8_t*>(&_line_delimiter), 1);
+        _stream.pull_in_data();
+        while (_stream.new_transaction()) {
+        }
+        _scanner->clear_held();
+        _scanner->clear_delimiters();
+        _is_line_taken = false;
+    }
+
+    /// Compresses the return values of the text replies and published messages started from now on; see
+    /// `compression.hpp`. Binary frames are never compressed.
+    void set_compression(bool is_enabled) { _is_compressing = is_enabled; }
+    bool is_compressing() const { return _is_compressing; }
+
+    /// Returns the amount of bytes that can still be written into the outgoing buffer.
+    size_t tx_available() const { return _output_buffer_size - std::min(_tx_pending, _output_buffer_size); }
+
+    /// Returns the amount of bytes in the outgoing buffer that are not yet pushed into the stream.
+    size_t tx_pending() const { return _tx_pending; }
+
+    /// Sizes the storage of the messages read with `read_message()`, and of the replies composed with
+    /// `result_pool()`, to `count` messages each. Storage beyond is allocated on the heap. Expects no such message
+    /// to be alive.
+    void reserve_message_storage(size_t count) {
+        _message_pool.reserve(count);
+        _result_pool.reserve(count);
+    }
+
+    /// Returns the pool in which the results of the replies to this link are stored; see
+    /// `OutgoingMessageFactory::from_rpc_result()`.
+    OutgoingMessageFactory::ResultPool& result_pool() { return _result_pool; }
+
+    /// Returns the pool in which the messages read with `read_message()` are stored
+    const core::ObjectPool<BufferedStream::Transaction>& message_pool() const { return _message_pool; }
 
     using IError = IncomingMessageFactory::Error;
 
+    /// Attempts to read a line from the buffer. The line's view is valid for as long as the transaction lives.
+    ///
+    /// The buffer is only scanned for a line once a delimiter has arrived: a slow sender dribbling a long line costs
+    /// time in proportion to the bytes it sends, rather than a rescan of the buffer for every byte.
+    std::optional<BufferedStream::Transaction> read_line() {
+        if (_scanner->delimiters() == 0) pull_line();
+        if (_scanner->delimiters() == 0 && !_is_line_taken) return std::nullopt;
+        auto transaction = _stream.new_transaction();
+        _is_line_taken = transaction.has_value();
+        if (transaction) _scanner->take_delimiter();
+        else _scanner->clear_delimiters(); // delimiters without line, such as the second of a CRLF
+        return transaction;
+    }
+
     /// Attempts to read a message from the buffer. Returns the message if successful, or an error code if not.
     spn::structure::Result<MessageWithStorage<BufferedStream::Transaction>, IError> read_message() {
-        auto transaction = _stream.new_transaction();
+        auto transaction = read_line();
         if (!transaction) return {};
         if (auto message = IncomingMessageFactory::from_view(transaction->incoming())) {
-            return MessageWithStorage<BufferedStream::Transaction>(
-                message.unwrap(), std::make_unique<BufferedStream::Transaction>(std::move(*transaction)));
+            return MessageWithStorage<BufferedStream::Transaction>(message.unwrap(),
+                                                                   _message_pool.acquire(std::move(*transaction)));
         } else if (message.is_failed()) {
             return message.error_value();
         }
         return {};
     }
 
+    /// A request read from a binary frame. The arguments refer into the datalink's buffer and are valid until the next
+    /// frame is read.
+    struct Frame {
+        uint8_t module_id;
+        uint8_t command_id;
+        OptStringView arguments;
+    };
+
+    enum class FError : uint8_t { MALFORMED_FRAME, BAD_CHECKSUM, UNKNOWN_FRAME_TYPE, OVERSIZED_FRAME };
+
+    /// Attempts to read a binary frame from the buffer. Returns the frame if successful, or an error code if not.
+    spn::structure::Result<Frame, FError> read_frame() {
+        using Result = spn::structure::Result<Frame, FError>;
+        spn_expect(_mode == Mode::BINARY);
+
+        _rx_frame.erase(_rx_frame.begin(), _rx_frame.begin() + _rx_consumed);
+        _rx_consumed = 0;
+
+        const auto delimiter = std::find(_rx_frame.begin(), _rx_frame.end(), 0);
+        if (delimiter == _rx_frame.end()) {
+            if (_rx_frame.size() < _input_buffer_size) return {};
+            _rx_frame.clear(); // a frame that does not fit the buffer can never be completed
+            return Result::failed(FError::OVERSIZED_FRAME);
+        }
+        _rx_consumed = std::distance(_rx_frame.begin(), delimiter) + 1;
+
+        const auto decoded_size = framing::cobs_decode(_rx_frame.data(), _rx_consumed - 1);
+        if (!decoded_size || *decoded_size < BinaryDialect::HEADER_SIZE + BinaryDialect::CRC_SIZE)
+            return Result::failed(FError::MALFORMED_FRAME);
+
+        const auto frame = std::string_view(reinterpret_cast<const char*>(_rx_frame.data()), *decoded_size);
+        const auto payload = frame.substr(0, frame.size() - BinaryDialect::CRC_SIZE);
+        const auto crc = static_cast<uint16_t>(static_cast<uint8_t>(frame[payload.size()]) << 8
+                                               | static_cast<uint8_t>(frame[payload.size() + 1]));
+        if (framing::crc16(payload) != crc) return Result::failed(FError::BAD_CHECKSUM);
+        if (static_cast<uint8_t>(payload[0]) != static_cast<uint8_t>(BinaryDialect::FrameType::REQUEST))
+            return Result::failed(FError::UNKNOWN_FRAME_TYPE);
+
+        _since_last_frame.reset();
+        const auto arguments = payload.substr(BinaryDialect::HEADER_SIZE);
+        return Frame{.module_id = static_cast<uint8_t>(payload[1]),
+                     .command_id = static_cast<uint8_t>(payload[2]),
+                     .arguments = arguments.empty() ? std::nullopt : OptStringView(arguments)};
+    }
+
+    /// Writes a binary frame into the outgoing buffer. Returns the bytes written, or zero if the frame did not fit.
+    size_t write_frame(BinaryDialect::FrameType type, uint8_t module_id, uint8_t command_id,
+                       const std::string_view& payload) {
+        const auto frame_size = BinaryDialect::HEADER_SIZE + payload.size() + BinaryDialect::CRC_SIZE;
+        if (framing::cobs_max_encoded_size(frame_size) + 1 > tx_available()) return 0;
+
+        const char header[] = {static_cast<char>(type), static_cast<char>(module_id), static_cast<char>(command_id)};
+        size_t bytes_written = 0;
+        const auto sink = [&](const std::string_view& encoded) {
+            const auto written = _stream.buffered_write(encoded);
+            _tx_pending += written;
+            bytes_written += written;
+        };
+        auto encoder = framing::FrameEncoder();
+        encoder.put(std::string_view(header, sizeof(header)), sink);
+        encoder.put(payload, sink);
+        encoder.finish(sink);
+        return bytes_written;
+    }
+
     using OError = OutgoingMessageFactory::Error;
 
     /// Write a message into the `Transaction` buffer. Returns the bytes written if succesful, or an errorcode if not.
@@ -60,21 +323,256 @@ public:
         size_t bytes_written = 0;
         //    bytes_written += _stream.buffered_write(Dialect::REPLY_HEADER);
 
+        if (msg.request_id) {
+            bytes_written += _stream.buffered_write(*msg.request_id);
+            bytes_written += _stream.buffered_write(Dialect::REQUEST_ID_SEPARATOR);
+        }
         bytes_written += _stream.buffered_write(msg.module);
         bytes_written += _stream.buffered_write(msg.operant);
         bytes_written += _stream.buffered_write(msg.cmd_or_status);
-        if (msg.arguments) {
+        if (msg.arguments && _is_compressing) {
+            bytes_written += _stream.buffered_write(Dialect::COMPRESSED_KV_SEPARATOR);
+            const auto sink = [this, &bytes_written](const std::string_view& encoded) {
+                bytes_written += _stream.buffered_write(encoded);
+            };
+            _compressor.put(*msg.arguments, sink);
+            _compressor.finish(sink);
+        } else if (msg.arguments) {
             bytes_written += _stream.buffered_write(std::string_view(":"));
             bytes_written += _stream.buffered_write(msg.arguments.value());
         }
         //    _stream.buffered_write(Dialect::REPLY_FOOTER);
         bytes_written += _stream.buffered_write(Dialect::REPLY_CRLF);
 
+        _tx_pending += bytes_written;
         return bytes_written;
     }
 
+    /// Writes a reply straight into the outgoing buffer. The reply line is opened by the first fragment of the return
+    /// value (or by `finalize()` if there is none) and closed by `finalize()`. In binary mode the reply is a frame,
+    /// encoded while it is written.
+    class ReplyWriter final : public prompt::ReplyWriter {
+    public:
+        /// A text reply reads `module` `operant` `tag`, where the tag defaults to the reply's status, and is closed by
+        /// `terminator`. A reply to a request carrying a request ID is preceded by that ID, which is copied: the reply
+        /// may be streamed long after its request's line is released.
+        ReplyWriter(Datalink& dl, const std::string_view& module,
+                    const std::string_view& operant = Dialect::OPERANT_REPLY, const OptStringView& tag = {},
+                    const std::string_view& terminator = Dialect::REPLY_CRLF, const OptStringView& request_id = {})
+            : _dl(dl), _module(module), _operant(operant), _tag(tag), _terminator(terminator),
+              _is_compressed(dl._is_compressing) {
+            if (!request_id) return;
+            spn_expect(request_id->size() <= _request_id.size());
+            _request_id_size = request_id->copy(_request_id.data(), _request_id.size());
+        }
+        /// A binary reply is a frame of `type` whose header is followed by `tag`, which defaults to the reply's status.
+        ReplyWriter(Datalink& dl, uint8_t module_id, uint8_t command_id,
+                    BinaryDialect::FrameType type = BinaryDialect::FrameType::REPLY, const OptStringView& tag = {})
+            : _dl(dl), _tag(tag), _is_binary(true), _frame_type(type), _module_id(module_id), _command_id(command_id) {}
+        ReplyWriter(const ReplyWriter&) = delete;
+        ReplyWriter& operator=(const ReplyWriter&) = delete;
+        ~ReplyWriter() override { spn_expect(_is_finalized); }
+
+        /// Closes the reply line; a streamed reply that is not complete by now is truncated. Returns the amount of
+        /// bytes written into the outgoing buffer.
+        size_t finalize() {
+            spn_assert(!_is_finalized);
+            cancel_stream();
+            if (!has_return_value()) write_header(false);
+            if (is_truncated()) WARN("Datalink: reply for %s was truncated", std::string(_module).c_str());
+            if (_is_binary) {
+                _encoder.finish([this](const std::string_view& encoded) { write_raw(encoded); });
+            } else {
+                if (_is_compressed && has_return_value()) {
+                    _dl._compressor.finish([this](const std::string_view& encoded) { write_raw(encoded); });
+                }
+                write_raw(_terminator);
+            }
+            _is_finalized = true;
+            return _bytes_written;
+        }
+
+    protected:
+        size_t available() const override {
+            const auto free = _dl.tx_available();
+            if (_is_binary) {
+                // room for the raw bytes of a frame, when encoded and delimited
+                const auto room = free > 2 ? (free - 2) * 254 / 255 : 0;
+                const auto reserved = _encoder.pending() + BinaryDialect::CRC_SIZE
+                                      + (has_return_value() ? 0 : BinaryDialect::HEADER_SIZE + tag().size());
+                return room > reserved ? room - reserved : 0;
+            }
+            const auto reserved = _terminator.size() + (has_return_value() ? 0 : header_size(true))
+                                  + (_is_compressed ? _dl._compressor.pending() : 0);
+            const auto room = free > reserved ? free - reserved : 0;
+            return _is_compressed ? room / compression::max_encoded_size(1) : room; // the worst case of compression
+        }
+
+        void sink(const std::string_view& fragment) override {
+            if (_is_binary) {
+                _encoder.put(fragment, [this](const std::string_view& encoded) { write_raw(encoded); });
+            } else if (_is_compressed) {
+                _dl._compressor.put(fragment, [this](const std::string_view& encoded) { write_raw(encoded); });
+            } else {
+                write_raw(fragment);
+            }
+        }
+
+        bool begin_return_value(size_t first_fragment_size) override {
+            if (first_fragment_size > available()) return false;
+            write_header(true);
+            return true;
+        }
+
+        bool raw_floats() const override { return _is_binary; }
+
+    private:
+        /// Returns the tag following the header; the status unless another tag was provided
+        std::string_view tag() const {
+            if (_tag) return *_tag;
+            if (_is_binary) return std::string_view(&_status_byte, 1);
+            return detail::numeric_status(status());
+        }
+
+        size_t header_size(bool with_return_value) const {
+            const auto request_id_size =
+                _request_id_size > 0 ? _request_id_size + Dialect::REQUEST_ID_SEPARATOR.size() : 0;
+            return request_id_size + _module.size() + _operant.size() + tag().size()
+                   + (with_return_value ? Dialect::KV_SEPARATOR.size() : 0);
+        }
+
+        void write_header(bool with_return_value) {
+            if (_is_binary) {
+                _status_byte = static_cast<char>(status());
+                const char header[] = {static_cast<char>(_frame_type), static_cast<char>(_module_id),
+                                       static_cast<char>(_command_id)};
+                sink(std::string_view(header, sizeof(header)));
+                sink(tag());
+                return;
+            }
+            if (_request_id_size > 0) {
+                write_raw(std::string_view(_request_id.data(), _request_id_size));
+                write_raw(Dialect::REQUEST_ID_SEPARATOR);
+            }
+            write_raw(_module);
+            write_raw(_operant);
+            write_raw(tag());
+            if (with_return_value) write_raw(_is_compressed ? Dialect::COMPRESSED_KV_SEPARATOR : Dialect::KV_SEPARATOR);
+        }
+
+        void write_raw(const std::string_view& s) {
+            const auto written = _dl._stream.buffered_write(s);
+            _dl._tx_pending += written;
+            _bytes_written += written;
+        }
+
+        Datalink& _dl;
+        const std::string_view _module;
+        const std::string_view _operant;
+        const OptStringView _tag;
+        const std::string_view _terminator;
+        std::array<char, Dialect::MAX_REQUEST_ID_SIZE> _request_id{};
+        size_t _request_id_size = 0; // zero if the request carried no ID
+        const bool _is_compressed = false; // the return value of a text reply is compressed by the datalink
+        char _status_byte = 0;
+        const bool _is_binary = false;
+        const BinaryDialect::FrameType _frame_type = BinaryDialect::FrameType::REPLY;
+        const uint8_t _module_id = BinaryDialect::UNKNOWN_ID;
+        const uint8_t _command_id = BinaryDialect::UNKNOWN_ID;
+        framing::FrameEncoder _encoder;
+        size_t _bytes_written = 0;
+        bool _is_finalized = false;
+    };
+
+    /// Returns a writer for a reply on behalf of `module`, closed by `terminator` and preceded by `request_id`, if
+    /// any. The module's view must outlive the writer.
+    ReplyWriter reply_writer(const std::string_view& module, const std::string_view& terminator = Dialect::REPLY_CRLF,
+                             const OptStringView& request_id = {}) {
+        return ReplyWriter(*this, module, Dialect::OPERANT_REPLY, {}, terminator, request_id);
+    }
+
+    /// Returns a writer for a reply to a request that could not be handled, closed by `terminator` and preceded by
+    /// `request_id`, if any.
+    ReplyWriter error_writer(const std::string_view& error, const std::string_view& terminator = Dialect::REPLY_CRLF,
+                             const OptStringView& request_id = {}) {
+        return ReplyWriter(*this, "BAD_MESSAGE", Dialect::OPERANT_REPLY, error, terminator, request_id);
+    }
+
+    /// Returns a writer for a binary reply to the request identified by `module_id` and `command_id`.
+    ReplyWriter reply_writer(uint8_t module_id, uint8_t command_id) {
+        spn_expect(_mode == Mode::BINARY);
+        return ReplyWriter(*this, module_id, command_id);
+    }
+
+    /// Returns a writer for an unsolicited message on behalf of `module`, tagged with `sequence`. The module's view
+    /// must outlive the writer.
+    ReplyWriter publish_writer(const std::string_view& module, uint8_t module_id, uint32_t sequence) {
+        if (_mode == Mode::BINARY) {
+            for (size_t i = 0; i < sizeof(sequence); ++i)
+                _publish_tag[i] = static_cast<char>(sequence >> (8 * i));
+            return ReplyWriter(*this, module_id, BinaryDialect::UNKNOWN_ID, BinaryDialect::FrameType::PUBLISH,
+                               std::string_view(_publish_tag.data(), sizeof(sequence)));
+        }
+        const int tag_size =
+            std::snprintf(_publish_tag.data(), _publish_tag.size(), "%lu", static_cast<unsigned long>(sequence));
+        return ReplyWriter(*this, module, Dialect::OPERANT_PUBLISH, std::string_view(_publish_tag.data(), tag_size));
+    }
+
 private:
+    using Timer = spn::structure::time::Timer;
+
+    /// Pulls bytes into the buffered stream until a line is complete, unless a switch of mode is pending. Returns the
+    /// amount of bytes pulled.
+    size_t pull_line() {
+        size_t pulled = 0;
+        while (!_pending_mode && _scanner->delimiters() == 0) {
+            const auto bytes = _stream.pull_in_data();
+            if (bytes == 0) break;
+            pulled += bytes;
+        }
+        return pulled;
+    }
+
+    /// Switches to `mode`. The bytes received but not yet read are handed over: those following the last line read
+    /// become the start of the first frame, and those following the last frame read are read as text.
+    void set_mode(Mode mode) {
+        if (mode == _mode) return;
+        LOG("Datalink: switching to %s mode", mode == Mode::BINARY ? "binary" : "text");
+        _mode = mode;
+        if (_mode == Mode::BINARY) {
+            _rx_frame.resize(std::max(_input_buffer_size, _scanner->held()));
+            _rx_frame.resize(_scanner->take_held(_rx_frame.data(), _rx_frame.size()));
+            _since_last_frame.reset();
+        } else {
+            _scanner->put_back(_rx_frame.data() + _rx_consumed, _rx_frame.size() - _rx_consumed);
+            std::vector<uint8_t>().swap(_rx_frame); // release the frame buffer
+            _rx_consumed = 0;
+        }
+    }
+
+    const size_t _input_buffer_size;
+    const size_t _output_buffer_size;
+    const char _line_delimiter; // terminates a partial line; see `discard_input()`
+    size_t _tx_pending = 0; // bytes written into the outgoing buffer, but not yet pushed
+
+    Mode _mode = Mode::TEXT;
+    std::optional<Mode> _pending_mode;
+    bool _is_compressing = false;
+    compression::Encoder _compressor; // shared by the replies of the link, which are written one at a time
+    k_time_ms _binary_timeout = k_time_ms(0);
+    Timer _since_last_frame;
+    std::vector<uint8_t> _rx_frame; // binary mode only
+    std::array<char, 12> _publish_tag{}; // sequence number of the unsolicited message being written
+    size_t _rx_consumed = 0;
+
+    std::shared_ptr<spn::io::Stream> _raw_stream;
+    std::shared_ptr<detail::DelimiterCountingStream> _scanner; // text mode reads through the scanner
     BufferedStream _stream;
+    bool _is_line_taken = false; // the buffered stream releases a taken line on its next transaction
+
+    // the storage of the messages of the message API; destroyed first, as the transactions refer to the stream
+    core::ObjectPool<BufferedStream::Transaction> _message_pool;
+    OutgoingMessageFactory::ResultPool _result_pool;
 };
 
 } // namespace kaskas::prompt
\ No newline at end of file
@@ -2,6 +2,8 @@
 #include <spine/core/debugging.hpp>
 #include <spine/core/utils/concatenate.hpp>
 
+#include <cstddef>
+#include <cstdint>
 #include <string_view>
 
 namespace kaskas::prompt {
@@ -13,12 +15,31 @@ struct Dialect {
     static constexpr std::string_view OPERANT_REQUEST = ":";
     static constexpr std::string_view OPERANT_REPLY = "<";
     static constexpr std::string_view OPERANT_PRINT_USAGE = "?";
+    static constexpr std::string_view OPERANT_PUBLISH = "!"; // outgoing only: an unsolicited message, such as telemetry
 
     enum class OP { REQUEST, REPLY, PRINT_USAGE, NOP }; // make sure this matches order of OPERANTS below
     static constexpr std::string_view OPERANTS = ":<?";
 
     static constexpr std::string_view KV_SEPARATOR = ":";
+    static constexpr std::string_view COMPRESSED_KV_SEPARATOR = "~"; // precedes a compressed return value
     static constexpr std::string_view VALUE_SEPARATOR = "|";
+    static constexpr std::string_view BATCH_SEPARATOR = ";"; // separates the requests of a batch, and their replies
+    static constexpr std::string_view RECORD_SEPARATOR = ","; // separates the records of a reply listing several
+
+    /// A request may be preceded by a request ID and `REQUEST_ID_SEPARATOR`, such as `7#MOC:foo`; its reply is preceded
+    /// by the same, such as `7#MOC<1:...`, so that a host keeping several requests in flight can match their replies.
+    static constexpr std::string_view REQUEST_ID_SEPARATOR = "#";
+    static constexpr size_t MAX_REQUEST_ID_SIZE = 8; // letters, digits, `-` and `_`
+
+    static constexpr bool is_valid_request_id(const std::string_view& id) {
+        if (id.empty() || id.size() > MAX_REQUEST_ID_SIZE) return false;
+        for (const auto c : id) {
+            const auto is_valid = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '-'
+                                  || c == '_';
+            if (!is_valid) return false;
+        }
+        return true;
+    }
 
     static constexpr OP optype_for_operant(const char operant) {
         for (size_t i = 0; i < OPERANTS.size(); ++i) {
@@ -30,4 +51,17 @@ struct Dialect {
     }
 };
 
+/// The binary dialect, negotiated through the built-in `Prompt` module. Frames are COBS encoded and delimited by a zero
+/// byte. A decoded frame reads `[type][module id][command id][payload][crc16]`; a reply carries its status as the first
+/// byte of its payload and an unsolicited message its 32-bit little-endian sequence number. The numeric IDs are listed
+/// by the usage operant.
+struct BinaryDialect {
+    enum class FrameType : uint8_t { REQUEST = 0x01, REPLY = 0x02, ERROR = 0x03, PUBLISH = 0x04 };
+
+    static constexpr uint8_t UNKNOWN_ID = 0xFF; // module or command ID of a frame that could not be read
+    static constexpr size_t HEADER_SIZE = 3; // type, module id and command id
+    static constexpr size_t REPLY_HEADER_SIZE = HEADER_SIZE + 1; // followed by the status
+    static constexpr size_t CRC_SIZE = 2;
+};
+
 } // namespace kaskas::prompt
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace kaskas::prompt::framing {
+
+/// Feeds a byte into a CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF).
+constexpr uint16_t crc16_update(uint16_t crc, uint8_t byte) {
+    crc ^= static_cast<uint16_t>(byte) << 8;
+    for (int i = 0; i < 8; ++i) {
+        crc = crc & 0x8000 ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+    }
+    return crc;
+}
+
+/// Returns the CRC-16/CCITT-FALSE of the provided bytes.
+constexpr uint16_t crc16(const std::string_view& data, uint16_t crc = 0xFFFF) {
+    for (const auto c : data) {
+        crc = crc16_update(crc, static_cast<uint8_t>(c));
+    }
+    return crc;
+}
+
+/// Returns an upper bound of the COBS encoded size of `size` bytes, excluding the frame delimiter.
+constexpr size_t cobs_max_encoded_size(size_t size) { return size + size / 254 + 1; }
+
+/// Encodes a frame on the fly: the bytes are COBS encoded, followed by their big-endian CRC-16 and a zero delimiter.
+/// At most a single block of 254 bytes is held back; everything else is passed to the sink as soon as it is known.
+class FrameEncoder {
+public:
+    /// Appends bytes to the frame; `sink` is called with every completed block of encoded bytes.
+    template<typename Sink>
+    void put(const std::string_view& bytes, Sink&& sink) {
+        for (const auto c : bytes) {
+            _crc = crc16_update(_crc, static_cast<uint8_t>(c));
+            put_encoded(static_cast<uint8_t>(c), sink);
+        }
+    }
+
+    /// Appends the CRC, flushes the last block and closes the frame with a delimiter.
+    template<typename Sink>
+    void finish(Sink&& sink) {
+        const auto crc = _crc;
+        put_encoded(static_cast<uint8_t>(crc >> 8), sink);
+        put_encoded(static_cast<uint8_t>(crc & 0xFF), sink);
+        flush_block(sink);
+        const char delimiter = 0;
+        sink(std::string_view(&delimiter, 1));
+        _crc = 0xFFFF;
+    }
+
+    /// Returns the amount of encoded bytes held back, that have not yet been passed to a sink.
+    size_t pending() const { return _length + 1; }
+
+private:
+    template<typename Sink>
+    void put_encoded(uint8_t byte, Sink& sink) {
+        if (byte == 0) {
+            flush_block(sink);
+            return;
+        }
+        _block[1 + _length++] = static_cast<char>(byte);
+        if (_length == 254) flush_block(sink); // a full block does not imply a zero
+    }
+
+    template<typename Sink>
+    void flush_block(Sink& sink) {
+        _block[0] = static_cast<char>(_length + 1);
+        sink(std::string_view(_block.data(), _length + 1));
+        _length = 0;
+    }
+
+    std::array<char, 255> _block{}; // code byte followed by up to 254 data bytes
+    size_t _length = 0;
+    uint16_t _crc = 0xFFFF;
+};
+
+/// Decodes a COBS encoded frame (without its delimiter) in place. Returns the decoded size, or nothing if the frame is
+/// malformed.
+inline std::optional<size_t> cobs_decode(uint8_t* data, size_t size) {
+    size_t read = 0;
+    size_t written = 0;
+    while (read < size) {
+        const auto code = data[read++];
+        if (code == 0 || read + code - 1 > size) return std::nullopt;
+        for (uint8_t i = 1; i < code; ++i) {
+            if (data[read] == 0) return std::nullopt;
+            data[written++] = data[read++];
+        }
+        if (code != 0xFF && read < size) data[written++] = 0;
+    }
+    return written;
+}
+
+} // namespace kaskas::prompt::framing
@@ -0,0 +1,315 @@
+#pragma once
+
+#include "kaskas/core/inline_function.hpp"
+#include "kaskas/prompt/datalink.hpp"
+#include "kaskas/prompt/rpc/recipe.hpp"
+
+#include <spine/core/debugging.hpp>
+#include <spine/io/stream/stream.hpp>
+#include <spine/platform/hal.hpp>
+#include <spine/structure/time/timers.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+namespace kaskas::prompt {
+
+namespace detail {
+
+/// A ring buffer of bytes with a single producer and a single consumer, either of which may be an interrupt; neither
+/// blocks the other. One slot is kept free to tell a full ring from an empty one.
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity) : _capacity(capacity), _slots(std::make_unique<uint8_t[]>(capacity)) {}
+
+    /// Producer side: appends a byte. Returns false if the ring is full.
+    bool push(uint8_t byte) {
+        const auto head = _head.load(std::memory_order_relaxed);
+        const auto next = advance(head);
+        if (next == _tail.load(std::memory_order_acquire)) return false;
+        _slots[head] = byte;
+        _head.store(next, std::memory_order_release);
+        return true;
+    }
+
+    /// Consumer side: copies up to `size` of the oldest bytes into `buffer`, without taking them. Returns the amount
+    /// copied.
+    size_t peek(uint8_t* buffer, size_t size) const {
+        const auto head = _head.load(std::memory_order_acquire);
+        auto tail = _tail.load(std::memory_order_relaxed);
+        size_t copied = 0;
+        while (copied < size && tail != head) {
+            buffer[copied++] = _slots[tail];
+            tail = advance(tail);
+        }
+        return copied;
+    }
+
+    /// Consumer side: takes `size` bytes, which must have been peeked.
+    void consume(size_t size) {
+        const auto tail = _tail.load(std::memory_order_relaxed) + size;
+        _tail.store(tail >= _capacity ? tail - _capacity : tail, std::memory_order_release);
+    }
+
+    /// Consumer side: takes up to `size` of the oldest bytes into `buffer`. Returns the amount taken.
+    size_t pop(uint8_t* buffer, size_t size) {
+        const auto taken = peek(buffer, size);
+        consume(taken);
+        return taken;
+    }
+
+    /// Returns the amount of bytes in the ring.
+    size_t size() const {
+        const auto head = _head.load(std::memory_order_acquire);
+        const auto tail = _tail.load(std::memory_order_acquire);
+        return head >= tail ? head - tail : _capacity - tail + head;
+    }
+
+    size_t capacity() const { return _capacity - 1; }
+
+private:
+    size_t advance(size_t index) const { return index + 1 == _capacity ? 0 : index + 1; }
+
+    const size_t _capacity;
+    std::unique_ptr<uint8_t[]> _slots;
+    std::atomic<size_t> _head{0}; // written by the producer only
+    std::atomic<size_t> _tail{0}; // written by the consumer only
+};
+
+} // namespace detail
+
+/// A stream that receives its incoming bytes one at a time from the UART's RX interrupt into a ring buffer, and signals
+/// once a line is complete. The `Datalink` reads the RX ring through `read()`.
+///
+/// Outgoing bytes are queued into a TX ring by `write()`, which never blocks, and are drained by the UART's TX
+/// interrupt or DMA through `transmit()`, or by `poll()` from the main loop. A 1 KB reply takes about 90 ms to drain at
+/// 115200 baud; that time is no longer taken from the event loop.
+///
+/// Each ring has a single producer and a single consumer; neither blocks the other. Bytes received while the RX ring
+/// is full are dropped and counted.
+///
+/// A host may negotiate a faster baud rate through the stream's recipe: see `request_baud_rate()`.
+class InterruptStream final : public spn::io::Stream {
+public:
+    /// Switches the UART to another baud rate, once everything written before has been transmitted
+    using BaudRateSwitch = core::InlineFunction<void(uint32_t)>;
+
+    struct Config {
+        size_t rx_buffer_size = 256; // capacity of the RX ring; one slot is kept free
+        std::string_view delimiters = "\r\n"; // a line is complete when one of these is received
+        size_t tx_buffer_size = 256; // capacity of the TX ring; one slot is kept free
+        uint32_t baud_rate = 0; // `poll()` drains the TX ring no faster than the line carries it; 0 drains it at once
+        size_t uart_tx_buffer_size = 64; // the UART driver's own TX buffer, which `poll()` never overfills
+        uint32_t max_baud_rate = 0; // the fastest rate a host may negotiate; 0 disables negotiation
+        k_time_ms baud_rate_confirm_timeout = k_time_ms(1000); // falls back when no confirmation arrives in time
+        BaudRateSwitch switch_baud_rate = nullptr;
+    };
+
+    /// Counters of the TX ring
+    struct TxStats {
+        size_t queued = 0; // bytes accepted by `write()`
+        size_t refused_bytes = 0; // bytes `write()` found no room for; counted again when the writer retries them
+        size_t high_water = 0; // the most bytes ever waiting in the TX ring
+    };
+
+    InterruptStream(std::shared_ptr<spn::io::Stream> uart, const Config& cfg)
+        : _cfg(cfg), _uart(std::move(uart)), _rx(_cfg.rx_buffer_size), _tx(_cfg.tx_buffer_size),
+          _baud_rate(_cfg.baud_rate), _line_budget(float(_cfg.uart_tx_buffer_size)), _last_drain(HAL::micros()) {
+        spn_expect(_cfg.rx_buffer_size > 1);
+        spn_expect(_cfg.tx_buffer_size > 1);
+        spn_expect(_cfg.max_baud_rate == 0 || (_cfg.baud_rate > 0 && _cfg.switch_baud_rate));
+        for (const auto c : _cfg.delimiters)
+            _is_delimiter[static_cast<uint8_t>(c)] = true;
+    }
+
+    void initialize() override { _uart->initialize(); }
+
+    /// Receives a byte into the RX ring. Safe to call from the RX interrupt; bytes are received either from the
+    /// interrupt or through `poll()`, never from both.
+    void receive(uint8_t byte) {
+        if (!_rx.push(byte)) {
+            _overruns.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (_is_delimiter[byte]) _is_line_ready.store(true, std::memory_order_release);
+    }
+
+    /// Takes up to `size` bytes to transmit from the TX ring. Safe to call from the TX interrupt or a DMA completion
+    /// handler; bytes are transmitted either from there or through `poll()`, never from both. Returns the amount taken.
+    size_t transmit(uint8_t* buffer, size_t size) { return _tx.pop(buffer, size); }
+
+    /// Receives the bytes the UART's driver has buffered itself and hands it the bytes waiting in the TX ring; for
+    /// Arduino cores that keep the UART's interrupts to themselves, such as STM32duino's `HardwareSerial`. Called from
+    /// the main loop; idle, it costs an `available()`.
+    void poll() {
+        std::array<uint8_t, 32> chunk{};
+        for (auto pending = _uart->available(); pending > 0; pending = _uart->available()) {
+            const auto received = _uart->read(chunk.data(), std::min(pending, chunk.size()));
+            if (received == 0) break;
+            for (size_t i = 0; i < received; ++i)
+                receive(chunk[i]);
+        }
+        drain();
+        negotiate();
+    }
+
+    /// Switches to `baud_rate` once everything written so far (such as the acknowledgement of the request) has been
+    /// transmitted. Unless `confirm_baud_rate()` is called within `baud_rate_confirm_timeout` of the switch, such as
+    /// when the host never made it to the new rate, the stream falls back to the rate it switched from. Returns false
+    /// if the rate cannot be negotiated.
+    bool request_baud_rate(uint32_t baud_rate) {
+        if (baud_rate == 0 || baud_rate > _cfg.max_baud_rate || _negotiation) return false;
+        _negotiation = Negotiation{.baud_rate = baud_rate, .fallback = _baud_rate};
+        return true;
+    }
+
+    /// Confirms the baud rate switched to. Returns false if no switch is waiting for confirmation.
+    bool confirm_baud_rate() {
+        if (!_negotiation || !_negotiation->is_switched) return false;
+        LOG("InterruptStream: confirmed %lu baud", static_cast<unsigned long>(_baud_rate));
+        _negotiation.reset();
+        return true;
+    }
+
+    uint32_t baud_rate() const { return _baud_rate; }
+
+    /// Attaches the datalink reading from this stream. A switch of baud rate then also waits for the datalink's
+    /// outgoing buffer to be pushed out, and drops the datalink's unread input along with the RX ring.
+    void attach_datalink(std::weak_ptr<Datalink> dl) { _dl = std::move(dl); }
+
+    /// The recipe through which a host negotiates a faster baud rate
+    std::unique_ptr<RPCRecipe> rpc_recipe() {
+        return std::make_unique<RPCRecipe>(RPCRecipe(
+            "UART", //
+            {
+                RPCModel::typed(
+                    "baud",
+                    [this](std::optional<uint32_t> baud_rate) {
+                        if (baud_rate && !request_baud_rate(*baud_rate)) return RPCResult(RPCResult::Status::BAD_INPUT);
+                        return RPCResult(std::to_string(_baud_rate));
+                    },
+                    "Args: baud rate. Switches to the rate once replied, and back unless confirmed by UART:confirmBaud "
+                    "at the new rate in time. Replies with the current rate"),
+                RPCModel::typed(
+                    "confirmBaud",
+                    [this]() {
+                        if (!confirm_baud_rate()) return RPCResult(RPCResult::Status::BAD_INPUT);
+                        return RPCResult(std::to_string(_baud_rate));
+                    },
+                    "Confirms the negotiated baud rate. Replies with the current rate"),
+            }));
+    }
+
+    /// Returns true if a delimiter was received since the last call.
+    bool take_line_ready() { return _is_line_ready.exchange(false, std::memory_order_acquire); }
+
+    /// Returns the amount of bytes dropped because the RX ring was full.
+    size_t overruns() const { return _overruns.load(std::memory_order_relaxed); }
+
+    const TxStats& tx_stats() const { return _tx_stats; }
+
+    /// Returns the amount of bytes waiting in the TX ring.
+    size_t tx_pending() const { return _tx.size(); }
+
+    size_t read(uint8_t* buffer, size_t size) override { return _rx.pop(buffer, size); }
+
+    /// Queues as many bytes as fit the TX ring. Never blocks; returns the amount queued.
+    size_t write(const uint8_t* buffer, size_t size) override {
+        size_t queued = 0;
+        while (queued < size && _tx.push(buffer[queued]))
+            ++queued;
+        _tx_stats.queued += queued;
+        _tx_stats.refused_bytes += size - queued; // the writer keeps the rest, and retries it
+        _tx_stats.high_water = std::max(_tx_stats.high_water, _tx.size());
+        return queued;
+    }
+
+    /// Returns the amount of received bytes waiting in the RX ring.
+    size_t available() const override { return _rx.size(); }
+
+private:
+    /// A negotiation of the baud rate, before and after the switch
+    struct Negotiation {
+        uint32_t baud_rate;
+        uint32_t fallback;
+        bool is_switched = false;
+        spn::structure::time::Timer since_switch;
+    };
+
+    /// Switches to a requested baud rate once the line is idle, or falls back from one that was not confirmed in time
+    void negotiate() {
+        if (!_negotiation) return;
+        if (!_negotiation->is_switched) {
+            const auto dl = _dl.lock();
+            const auto is_line_idle = _tx.size() == 0 && _line_budget >= float(_cfg.uart_tx_buffer_size)
+                                      && (!dl || dl->tx_pending() == 0);
+            if (!is_line_idle) return;
+            switch_baud_rate(_negotiation->baud_rate);
+            _negotiation->is_switched = true;
+            _negotiation->since_switch.reset();
+        } else if (_negotiation->since_switch.time_since_last(false) >= _cfg.baud_rate_confirm_timeout) {
+            WARN("InterruptStream: %lu baud was not confirmed, falling back",
+                 static_cast<unsigned long>(_negotiation->baud_rate));
+            switch_baud_rate(_negotiation->fallback);
+            _negotiation.reset();
+        }
+    }
+
+    /// Switches the UART and the pacing of the TX ring to `baud_rate`. Bytes received at the former rate are dropped,
+    /// from the RX ring as from the attached datalink.
+    void switch_baud_rate(uint32_t baud_rate) {
+        LOG("InterruptStream: switching to %lu baud", static_cast<unsigned long>(baud_rate));
+        _cfg.switch_baud_rate(baud_rate);
+        _baud_rate = baud_rate;
+        _rx.consume(_rx.size());
+        _is_line_ready.store(false, std::memory_order_relaxed);
+        if (const auto dl = _dl.lock()) dl->discard_input();
+    }
+
+    /// Hands the UART driver as many bytes as it takes without blocking: as many as the line carried away since the
+    /// last drain, up to the size of the driver's buffer.
+    void drain() {
+        auto budget = _tx.size();
+        if (_baud_rate > 0) {
+            const auto now = HAL::micros();
+            const auto carried = (now - _last_drain).raw<float>() * float(_baud_rate) / 10 / 1e6f; // 8N1
+            _line_budget = std::min(float(_cfg.uart_tx_buffer_size), _line_budget + carried);
+            _last_drain = now;
+            budget = std::min(budget, static_cast<size_t>(_line_budget));
+        }
+
+        std::array<uint8_t, 32> chunk{};
+        while (budget > 0) {
+            const auto peeked = _tx.peek(chunk.data(), std::min(budget, chunk.size()));
+            const auto written = _uart->write(chunk.data(), peeked);
+            _tx.consume(written);
+            budget -= written;
+            if (_baud_rate > 0) _line_budget -= float(written);
+            if (written == 0 || written < peeked) break;
+        }
+    }
+
+    const Config _cfg;
+    std::shared_ptr<spn::io::Stream> _uart;
+
+    detail::SpscRing _rx; // filled by the RX interrupt, emptied by the main loop
+    detail::SpscRing _tx; // filled by the main loop, emptied by the TX interrupt or `poll()`
+    std::atomic<bool> _is_line_ready{false};
+    std::atomic<size_t> _overruns{0};
+    TxStats _tx_stats;
+
+    uint32_t _baud_rate; // the rate the UART runs at
+    float _line_budget; // bytes the UART driver takes without blocking
+    k_time_us _last_drain;
+    std::optional<Negotiation> _negotiation;
+    std::weak_ptr<Datalink> _dl; // the datalink reading from this stream, which owns it
+
+    std::array<bool, 256> _is_delimiter{};
+};
+
+} // namespace kaskas::prompt
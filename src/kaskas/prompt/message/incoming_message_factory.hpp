@@ -7,109 +7,112 @@
 #include <spine/core/utils/string.hpp>
 #include <spine/structure/result.hpp>
 
-#include <cstring>
+#include <array>
+#include <cstdint>
 #include <optional>
 #include <string_view>
 
 namespace kaskas::prompt {
 
+namespace detail {
+/// The classes of characters the message tokenizer acts upon. A character may belong to several classes; a character
+/// that belongs to none is part of a token.
+enum CharClass : uint8_t { TOKEN = 0, OPERANT_REQUEST = 1 << 0, KV_SEPARATOR = 1 << 1, REQUEST_ID_SEPARATOR = 1 << 2 };
+
+constexpr std::array<uint8_t, 256> make_char_classes() {
+    std::array<uint8_t, 256> classes{};
+    for (const auto c : Dialect::OPERANT_REQUEST)
+        classes[static_cast<uint8_t>(c)] |= OPERANT_REQUEST;
+    for (const auto c : Dialect::KV_SEPARATOR)
+        classes[static_cast<uint8_t>(c)] |= KV_SEPARATOR;
+    for (const auto c : Dialect::REQUEST_ID_SEPARATOR)
+        classes[static_cast<uint8_t>(c)] |= REQUEST_ID_SEPARATOR;
+    return classes;
+}
+
+constexpr auto char_classes = make_char_classes();
+} // namespace detail
+
 class IncomingMessageFactory {
 public:
-    enum class Error : uint8_t { EMPTY, MALFORMED_MODULE, MALFORMED_COMMAND, MALFORMED_OPERANT };
+    enum class Error : uint8_t { EMPTY, MALFORMED_MODULE, MALFORMED_COMMAND, MALFORMED_OPERANT, MALFORMED_REQUEST_ID };
 
     /// Create a Message from the provided string_view.
-    static spn::structure::Result<Message, Error> from_view(const std::string_view& view) {
-        if (view.empty()) return spn::structure::Result<Message, Error>::failed(Error::EMPTY);
-
-        const auto parse = [](ParseContext& context) -> ParseResult {
-            return ParseResult::intermediary(context)
-                .chain([](ParseContext& ctx) { return throw_out_empty_messages(ctx); })
-                .chain([](ParseContext& ctx) { return parse_usage_request(ctx); })
-                .chain([](ParseContext& ctx) { return throw_out_malformed_messages(ctx); })
-                .chain([](ParseContext& ctx) { return parse_operant(ctx); })
-                .chain([](ParseContext& ctx) { return parse_command(ctx); })
-                .chain([](ParseContext& ctx) { return parse_arguments(ctx); })
-                .chain([](ParseContext& ctx) { return parse_finalizer(ctx); });
-        };
-
-        auto ctx = ParseContext(view);
-        auto result = parse(ctx);
-
-        if (result.is_success()) return result.unwrap();
-        if (result.is_failed()) return spn::structure::Result<Message, Error>::failed(result.unwrap_error_value());
-        return {};
-    }
-
-private:
-    struct ParseContext {
-        explicit ParseContext(const std::string_view& view) : view(view), head(view.data()) {}
-        std::string_view view;
-
-        const char* head;
-        size_t remaining() const { return view.size() - (head - view.data()); }
-
-        std::string_view module;
-        std::string_view operant;
-        std::string_view command;
-        std::optional<std::string_view> arguments;
-    };
-
-    using ParseResult = spn::structure::Result<Message, Error, ParseContext>;
+    ///
+    /// The view is tokenized in a single pass, looking up each character's class in a table: the module runs up to the
+    /// operant, the command up to the key-value separator and the arguments are the remainder, which is not scanned.
+    /// A request ID in front of the module is split off first.
+    static spn::structure::Result<Message, Error> from_view(std::string_view view) {
+        using Result = spn::structure::Result<Message, Error>;
+
+        const auto request_id = split_request_id(view);
+        if (request_id && !Dialect::is_valid_request_id(*request_id)) {
+            return Result::failed(Error::MALFORMED_REQUEST_ID);
+        }
 
-    static ParseResult throw_out_empty_messages(ParseContext& ctx) {
         // if an incoming string is empty, do not parse any further
-        if (ctx.view.size() == 0) return ParseResult::failed(Error::EMPTY);
-        return ParseResult::intermediary(ctx);
-    }
+        if (view.empty()) return Result::failed(Error::EMPTY);
 
-    static ParseResult parse_usage_request(ParseContext& ctx) {
         // if an incoming string starts with a Dialect::OPERANT_PRINT_USAGE operant, do not parse any further
-        if (spn::core::utils::starts_with(ctx.view, Dialect::OPERANT_PRINT_USAGE))
-            return Message(Dialect::OPERANT_PRINT_USAGE, Dialect::OPERANT_PRINT_USAGE);
-        return ParseResult::intermediary(ctx);
-    }
+        if (spn::core::utils::starts_with(view, Dialect::OPERANT_PRINT_USAGE))
+            return Message(Dialect::OPERANT_PRINT_USAGE, Dialect::OPERANT_PRINT_USAGE, {}, std::nullopt, request_id);
+
+        enum class Token { MODULE, COMMAND };
+        auto token = Token::MODULE;
+        size_t command_start = 0;
+
+        for (size_t i = 0; i < view.size(); ++i) {
+            const auto char_class = detail::char_classes[static_cast<uint8_t>(view[i])];
+            if (token == Token::MODULE && (char_class & detail::OPERANT_REQUEST)) {
+                if (i == 0) return Result::failed(Error::MALFORMED_MODULE); // illegal: empty module
+                token = Token::COMMAND;
+                command_start = i + 1;
+            } else if (token == Token::COMMAND && (char_class & detail::KV_SEPARATOR)) {
+                if (i == command_start) return Result::failed(Error::MALFORMED_COMMAND); // illegal: empty command
+                return Message(module_of(view, command_start), operant_of(view, command_start),
+                               view.substr(command_start, i - command_start), view.substr(i + 1), request_id);
+            }
+        }
 
-    static ParseResult throw_out_malformed_messages(ParseContext& ctx) {
-        // if an incoming string is empty, do not parse any further
-        if (ctx.view.size() == 0) return ParseResult::failed(Error::EMPTY);
-        return ParseResult::intermediary(ctx);
+        if (token == Token::MODULE) return Result::failed(Error::MALFORMED_OPERANT);
+        if (command_start == view.size()) return Result::failed(Error::MALFORMED_COMMAND); // illegal: empty command
+        return Message(module_of(view, command_start), operant_of(view, command_start), view.substr(command_start),
+                       std::nullopt, request_id);
     }
 
-    static ParseResult parse_operant(ParseContext& ctx) {
-        spn_assert(ctx.head);
-
-        if (auto op = spn::core::utils::find_first_of({ctx.head, ctx.remaining()}, Dialect::OPERANT_REQUEST);
-            op != std::string::npos) {
-            if (op == 0) return ParseResult::failed(Error::MALFORMED_MODULE); // illegal: empty module
-            ctx.module = std::string_view(ctx.head, op);
-            ctx.head += op;
-            ctx.operant = std::string_view(ctx.head, 1);
-            ctx.head += 1;
-            return ParseResult::intermediary(ctx);
+    /// Splits the request ID off the front of `request`, leaving the remainder in `request`. Returns nothing if the
+    /// request carries no ID: one is only looked for in front of the operant, and never in a usage request.
+    static std::optional<std::string_view> split_request_id(std::string_view& request) {
+        if (spn::core::utils::starts_with(request, Dialect::OPERANT_PRINT_USAGE)) return std::nullopt;
+        for (size_t i = 0; i < request.size(); ++i) {
+            const auto char_class = detail::char_classes[static_cast<uint8_t>(request[i])];
+            if (char_class & detail::OPERANT_REQUEST) return std::nullopt;
+            if (char_class & detail::REQUEST_ID_SEPARATOR) {
+                const auto request_id = request.substr(0, i);
+                request = request.substr(i + Dialect::REQUEST_ID_SEPARATOR.size());
+                return request_id;
+            }
         }
-        return ParseResult::failed(Error::MALFORMED_OPERANT);
+        return std::nullopt;
     }
 
-    static ParseResult parse_command(ParseContext& ctx) {
-        if (auto delim = spn::core::utils::find_first_of({ctx.head, ctx.remaining()}, Dialect::KV_SEPARATOR);
-            delim != std::string::npos) {
-            if (delim == 0) return ParseResult::failed(Error::MALFORMED_COMMAND); // illegal: empty command
-            ctx.command = std::string_view(ctx.head, delim);
-            ctx.head += delim + 1; // +1 to remove the delim itself as well
-            return ParseResult::intermediary(ctx);
-        }
-        if (ctx.remaining() == 0) return ParseResult::failed(Error::MALFORMED_COMMAND); // illegal: empty command
-        ctx.command = std::string_view(ctx.head, ctx.remaining());
-        return ParseResult(Message(ctx.module, ctx.operant, ctx.command));
+    /// Splits the first request off a batch of requests separated by `Dialect::BATCH_SEPARATOR`, leaving the remainder
+    /// in `batch`. A line without separator is a batch of one request.
+    static std::string_view next_in_batch(std::string_view& batch) {
+        const auto separator = batch.find(Dialect::BATCH_SEPARATOR);
+        const auto request = batch.substr(0, separator);
+        batch = separator == std::string_view::npos ? std::string_view()
+                                                    : batch.substr(separator + Dialect::BATCH_SEPARATOR.size());
+        return request;
     }
 
-    static ParseResult parse_arguments(ParseContext& ctx) {
-        ctx.arguments = std::string_view(ctx.head, ctx.remaining());
-        return ParseResult::intermediary(ctx);
+private:
+    /// The module and the single character operant precede the command
+    static std::string_view module_of(const std::string_view& view, size_t command_start) {
+        return view.substr(0, command_start - 1);
     }
-
-    static ParseResult parse_finalizer(ParseContext& ctx) {
-        return ParseResult(Message(ctx.module, ctx.operant, ctx.command, ctx.arguments));
+    static std::string_view operant_of(const std::string_view& view, size_t command_start) {
+        return view.substr(command_start - 1, 1);
     }
 };
 
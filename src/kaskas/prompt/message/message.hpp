@@ -1,5 +1,7 @@
 #pragma once
 
+#include "kaskas/core/object_pool.hpp"
+
 #include <memory>
 #include <optional>
 #include <string_view>
@@ -12,11 +14,12 @@ class IncomingMessageFactory;
 class Message {
 public:
     Message(const Message& other)
-        : module(other.module), operant(other.operant), cmd_or_status(other.cmd_or_status), arguments(other.arguments) {
-    }
+        : module(other.module), operant(other.operant), cmd_or_status(other.cmd_or_status), arguments(other.arguments),
+          request_id(other.request_id) {}
     Message(Message&& other)
         : module(std::move(other.module)), operant(std::move(other.operant)),
-          cmd_or_status(std::move(other.cmd_or_status)), arguments(std::move(other.arguments)) {}
+          cmd_or_status(std::move(other.cmd_or_status)), arguments(std::move(other.arguments)),
+          request_id(std::move(other.request_id)) {}
 
     Message& operator=(const Message& other) {
         if (this == &other) return *this;
@@ -24,6 +27,7 @@ public:
         operant = other.operant;
         cmd_or_status = other.cmd_or_status;
         arguments = other.arguments;
+        request_id = other.request_id;
         return *this;
     }
     Message& operator=(Message&& other) {
@@ -32,27 +36,36 @@ public:
         operant = std::move(other.operant);
         cmd_or_status = std::move(other.cmd_or_status);
         arguments = std::move(other.arguments);
+        request_id = std::move(other.request_id);
         return *this;
     }
     Message(const std::string_view& module, const std::string_view& operant,
-            const std::string_view& command_or_status = {}, const std::optional<std::string_view>& arguments = {})
-        : module(module), operant(operant), cmd_or_status(command_or_status), arguments(arguments) {}
+            const std::string_view& command_or_status = {}, const std::optional<std::string_view>& arguments = {},
+            const std::optional<std::string_view>& request_id = {})
+        : module(module), operant(operant), cmd_or_status(command_or_status), arguments(arguments),
+          request_id(request_id) {}
     ~Message() = default;
 
     std::string_view module;
     std::string_view operant;
     std::string_view cmd_or_status;
     std::optional<std::string_view> arguments;
+    std::optional<std::string_view> request_id; // echoed in front of the reply; see `Dialect::REQUEST_ID_SEPARATOR`
 
     /// Returns the message as a string.
     [[nodiscard]] std::string as_string() const {
         std::string s{};
 
-        auto reserved_length = module.size() + operant.size() + cmd_or_status.size()
+        auto reserved_length = (request_id ? request_id->size() + Dialect::REQUEST_ID_SEPARATOR.size() : 0)
+                               + module.size() + operant.size() + cmd_or_status.size()
                                + 1 /* kvsep */ + arguments.value_or("").size() + 1 /* nullbyte */;
         s.reserve(reserved_length);
         reserved_length = s.capacity(); // for sanity checks below
 
+        if (request_id) {
+            s += *request_id;
+            s += Dialect::REQUEST_ID_SEPARATOR;
+        }
         s += module;
         s += operant;
         s += cmd_or_status;
@@ -67,10 +80,11 @@ public:
 };
 
 template<typename T>
-/// A `Message` with embedded storage to guarantee the lifetime of Message's internal std::string_views.
+/// A `Message` with embedded storage to guarantee the lifetime of Message's internal std::string_views. The storage is
+/// taken from an `ObjectPool`, or from the heap.
 class MessageWithStorage : public Message {
 public:
-    MessageWithStorage(Message&& message, std::unique_ptr<T> storage)
+    MessageWithStorage(Message&& message, core::Pooled<T> storage)
         : Message(std::move(message)), _storage(std::move(storage)) {}
 
     const T& storage() const {
@@ -79,7 +93,7 @@ public:
     }
 
 private:
-    std::unique_ptr<T> _storage;
+    core::Pooled<T> _storage;
 };
 
 } // namespace kaskas::prompt
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "kaskas/core/object_pool.hpp"
 #include "kaskas/prompt/dialect.hpp"
 #include "kaskas/prompt/rpc/result.hpp"
 #include "message.hpp"
@@ -19,9 +20,14 @@ class OutgoingMessageFactory {
 public:
     enum class Error : uint8_t {};
 
-    /// Creates a Message from an RPC result and a buffer.
+    using ResultPool = core::ObjectPool<RPCResult>;
+
+    /// Creates a Message from an RPC result and a buffer. The reply echoes the request ID of its request, if any; the
+    /// views of the module and request ID must outlive the message. The result is moved into a slot of `pool`, such as
+    /// `Datalink::result_pool()`, or onto the heap when no pool is provided.
     static spn::structure::Result<MessageWithStorage<RPCResult>, Error>
-    from_rpc_result(RPCResult&& result, const std::string_view& module) {
+    from_rpc_result(RPCResult&& result, const std::string_view& module,
+                    const std::optional<std::string_view>& request_id = std::nullopt, ResultPool* pool = nullptr) {
         const auto parse = [](ParseContext&& context) -> ParseResult {
             return ParseResult::intermediary(std::move(context))
                 .chain([](ParseContext& ctx) { return parse_operant(ctx); })
@@ -30,8 +36,9 @@ public:
                 .chain([](ParseContext& ctx) { return parse_finalizer(ctx); });
         };
 
-        auto persistent_result = std::make_unique<RPCResult>(result);
-        auto parse_result = parse(ParseContext(*persistent_result, module));
+        auto persistent_result = pool ? pool->acquire(std::move(result))
+                                      : core::Pooled<RPCResult>(std::make_unique<RPCResult>(std::move(result)));
+        auto parse_result = parse(ParseContext(*persistent_result, module, request_id));
 
         if (parse_result.is_success()) {
             return MessageWithStorage<RPCResult>(std::move(parse_result.unwrap()), std::move(persistent_result));
@@ -47,10 +54,12 @@ public:
 
 private:
     struct ParseContext {
-        explicit ParseContext(const RPCResult& result, const std::string_view& module)
-            : result(result), module(module) {}
+        explicit ParseContext(const RPCResult& result, const std::string_view& module,
+                              const std::optional<std::string_view>& request_id)
+            : result(result), module(module), request_id(request_id) {}
         const RPCResult& result;
         std::string_view module;
+        std::optional<std::string_view> request_id;
         std::string_view operant;
         std::string_view status;
         std::optional<std::string_view> arguments;
@@ -71,7 +80,7 @@ private:
         return ParseResult::intermediary(std::move(ctx));
     }
     static ParseResult parse_finalizer(ParseContext& ctx) {
-        return ParseResult(Message(ctx.module, ctx.operant, ctx.status, ctx.arguments));
+        return ParseResult(Message(ctx.module, ctx.operant, ctx.status, ctx.arguments, ctx.request_id));
     }
 };
 
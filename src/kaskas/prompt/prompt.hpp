@@ -5,20 +5,58 @@
 #include "kaskas/prompt/message/incoming_message_factory.hpp"
 #include "kaskas/prompt/message/message.hpp"
 #include "kaskas/prompt/message/outgoing_message_factory.hpp"
+#include "kaskas/prompt/rpc/reply_cache.hpp"
 #include "kaskas/prompt/rpc/rpc.hpp"
 
 #include <spine/core/debugging.hpp>
 #include <spine/platform/hal.hpp>
+#include <spine/structure/time/timers.hpp>
 
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <memory>
 #include <optional>
 #include <string_view>
+#include <vector>
 
 namespace kaskas::prompt {
 
 namespace detail {
 
+/// A bucket of up to `capacity` tokens, refilled at `refill_per_s` tokens per second. A rate of zero disables it.
+class TokenBucket {
+public:
+    TokenBucket(float capacity, float refill_per_s)
+        : _capacity(capacity), _refill_per_s(refill_per_s), _tokens(capacity), _last_refill(HAL::micros()) {}
+
+    /// Takes a token if at least `reserve` tokens remain afterwards. Returns false if the bucket is too empty.
+    bool take(float reserve = 0) {
+        if (!is_enabled()) return true;
+        refill();
+        if (_tokens < 1 + reserve) return false;
+        _tokens -= 1;
+        return true;
+    }
+
+    bool is_enabled() const { return _refill_per_s > 0; }
+
+private:
+    void refill() {
+        // microseconds, as a bucket polled every millisecond would lose most of its refill to rounding
+        const auto now = HAL::micros();
+        _tokens = std::min(_capacity, _tokens + (now - _last_refill).raw<float>() * _refill_per_s / 1e6f);
+        _last_refill = now;
+    }
+
+    const float _capacity;
+    const float _refill_per_s;
+    float _tokens;
+    k_time_us _last_refill;
+};
+
 } // namespace detail
 
 class Prompt {
@@ -27,69 +65,492 @@ public:
         size_t io_buffer_size; // size of input and output buffer
         const std::string_view line_delimiters = "\r\n"; // delimiters to split input with
         size_t max_recipes_count = 32; // exact or maximum amount of recipes loadable
+        size_t max_datalinks = 2; // maximum amount of datalinks serviced at once
+        size_t max_messages_per_update = 16; // maximum amount of messages handled per datalink in a call to `update()`
+        k_time_ms max_update_duration = k_time_ms(5); // time budget of a single call to `update()`
+        k_time_ms binary_mode_timeout = k_time_ms(30000); // fall back to text when no frame is received for this long
+        size_t max_tickets = 4; // amount of tickets of asynchronous RPCs kept at once
+        size_t max_cached_replies = 8; // amount of replies of models with a cache policy kept at once
+        size_t rate_limit_burst = 32; // requests a datalink may send at once before it is rate limited
+        size_t rate_limit_per_s = 50; // sustained requests per second per datalink; zero disables rate limiting
+        size_t max_pooled_messages = 2; // messages per datalink read or replied to without allocation; see `Datalink`
     };
 
     Prompt(const Config&& cfg)
-        : _cfg(cfg), _rpc_factory(RPCFactory::Config{.directory_size = _cfg.max_recipes_count}) {}
+        : _cfg(cfg), _rpc_factory(RPCFactory::Config{.directory_size = _cfg.max_recipes_count}),
+          _tickets(RPCTicketOffice::Config{.max_tickets = _cfg.max_tickets}),
+          _reply_cache(RPCReplyCache::Config{.max_entries = _cfg.max_cached_replies}) {
+        spn_expect(_cfg.io_buffer_size > 2 * ReplyWriter::max_chunk_size); // room for a streamed reply to progress
+        _links.reserve(_cfg.max_datalinks);
+        _rpc_factory.hotload_rpc_recipe(rpc_recipe());
+        _tickets.set_listener([this](const RPCTicket& ticket) { publish_ticket(ticket); });
+    }
 
 public:
     /// Initialize the prompt
     void initialize() {
         LOG("Prompt initialized")
-        spn_assert(_dl);
-        _dl->initialize();
+        spn_assert(!_links.empty());
+        for (auto& link : _links)
+            link->dl->initialize();
+        _rpc_factory.build_index(); // all recipes are loaded by now
     }
 
-    /// Pulls messages from the datalink, extracts RPC information, invokes the RPC and writes back a returnstatus
+    /// Pulls messages from the datalinks, extracts RPC information, invokes the RPC and writes back a returnstatus.
+    /// The datalinks are serviced round-robin, a message at a time, until every link is drained or has spent its
+    /// message budget, or the time budget is spent. A streamed reply is resumed as its link's outgoing buffer drains;
+    /// no other message of that link is handled until it is complete.
+    ///
+    /// A link sending requests faster than its rate limit is replied to with `BUSY`, without invoking the RPC; bulk
+    /// requests are rejected first, safety requests never. The time spent in `update()` thus stays bounded by the
+    /// time budget, however hard a host floods the prompt.
     void update() {
-        spn_assert(_dl);
+        spn_assert(!_links.empty());
+        if (_is_updating) return; // called from within an RPC
+        _is_updating = true;
+
+        for (auto& link : _links) {
+            link->handled = 0;
+            link->is_drained = false;
+        }
+
+        auto budget = Timer();
+        for (bool is_serviced = true; is_serviced;) {
+            is_serviced = false;
+            for (size_t i = 0; i < _links.size(); ++i) {
+                if (!service(*_links[(_first_link + i) % _links.size()])) continue;
+                is_serviced = true;
+                if (budget.time_since_last(false) >= _cfg.max_update_duration) {
+                    DBG("Prompt: time budget spent");
+                    is_serviced = false;
+                    break;
+                }
+            }
+        }
+        _first_link = (_first_link + 1) % _links.size(); // the budget runs out on another link next time
+
+        for (auto& link : _links)
+            link->dl->push(); // push out published messages
+        _is_updating = false;
+    }
+
+    /// Services the datalinks on behalf of an operation that blocks the caller of `update()`, such as an autotune run
+    /// from an event handler, so that the operation's ticket can be polled. Only `Prompt:ticket` is invoked; every
+    /// other request is replied to with `BUSY`, so that no RPC runs from within the operation. Ticket updates and
+    /// replies streamed from before are pushed out as usual. The streams beneath the datalinks are serviced through
+    /// the stream poller, as the main loop that otherwise does is blocked.
+    void serve_tickets() {
+        if (_stream_poller) _stream_poller(); // receives the requests
+        _is_serving_tickets = true;
+        update();
+        _is_serving_tickets = false;
+        if (_stream_poller) _stream_poller(); // transmits the replies
+    }
+
+    /// Sets the poller that services the streams beneath the datalinks, such as `InterruptStream::poll()`, from within
+    /// `serve_tickets()`. Not needed for streams serviced by interrupts.
+    using StreamPoller = core::InlineFunction<void()>;
+    void set_stream_poller(StreamPoller poller) { _stream_poller = std::move(poller); }
+
+    /// Returns true if the prompt has nothing to do until a new line arrives: every pending message was handled, no
+    /// reply is being streamed and every outgoing buffer is pushed out.
+    bool is_idle() const {
+        return std::all_of(_links.begin(), _links.end(), [](const std::unique_ptr<Link>& link) {
+            return link->is_drained && !link->reply && link->dl->tx_pending() == 0;
+        });
+    }
+
+    /// Sets the listener that is called when a message is published outside of `update()`, so that an idle prompt is
+    /// updated again to push it out.
+    using PublishListener = core::InlineFunction<void()>;
+    void set_publish_listener(PublishListener listener) { _publish_listener = std::move(listener); }
+
+    /// The tickets of asynchronous RPCs. A long-running operation posts its progress and result to its ticket, which
+    /// the host polls with `Prompt:ticket:<id>`; every update is published as well.
+    RPCTicketOffice& tickets() { return _tickets; }
 
-        _dl->pull(); // pull messages from the Datalink's stream (such as UART) into its buffer
+    /// The cache of replies of models with a cache policy. Its hit and miss counters are read with `Prompt:cacheStats`.
+    const RPCReplyCache& reply_cache() const { return _reply_cache; }
+
+    /// Publishes an unsolicited message on behalf of `module` on every datalink, tagged with `sequence`; `write` writes
+    /// the message into the provided `ReplyWriter`, once per link. On a link, the message is only started when
+    /// `max_size` bytes of return value fit the outgoing buffer, so that it never blocks, and not while a reply is
+    /// being streamed. Returns false if the message was dropped or truncated on any link. The message is pushed out on
+    /// the next `update()`.
+    template<typename F>
+    bool publish(const std::string_view& module, uint32_t sequence, size_t max_size, F&& write) {
+        spn_assert(!_links.empty());
+        bool is_published = true;
+        bool is_written = false;
+        for (auto& link : _links) {
+            const auto written = publish(*link, module, sequence, max_size, write);
+            is_written |= bool(written);
+            is_published &= written.value_or(false);
+        }
+        if (is_written && !_is_updating && _publish_listener) _publish_listener();
+        return is_published;
+    }
+
+    /// Adds a datalink, such as a UART, to be serviced by the prompt. At most `max_datalinks` are serviced; every link
+    /// has its own buffers, message storage, message budget and rate limit.
+    void add_datalink(std::shared_ptr<Datalink> dl) {
+        spn_assert(dl);
+        spn_assert(_links.size() < _cfg.max_datalinks);
+        spn_assert(!_is_updating);
+        dl->reserve_message_storage(_cfg.max_pooled_messages);
+        _links.emplace_back(std::make_unique<Link>(
+            std::move(dl), detail::TokenBucket(float(_cfg.rate_limit_burst), float(_cfg.rate_limit_per_s))));
+    }
+
+    /// Replaces every datalink by `dl`, abandoning the replies streamed on them
+    void hotload_datalink(std::shared_ptr<Datalink> dl) {
+        spn_assert(!_is_updating);
+        _links.clear();
+        _first_link = 0;
+        add_datalink(std::move(dl));
+    }
+
+    /// Add an `RPCRecipe` to the prompt.
+    void hotload_rpc_recipe(std::unique_ptr<RPCRecipe> recipe) {
+        DBG("Prompt: Loading recipe: %s", std::string(recipe->module()).c_str());
+        _rpc_factory.hotload_rpc_recipe(std::move(recipe));
+        _reply_cache.clear(); // the recipe may replace models with a cached reply
+    }
+
+private:
+    using Timer = spn::structure::time::Timer;
+
+    /// A datalink and the reply being written on it
+    struct Link {
+        Link(std::shared_ptr<Datalink> dl, const detail::TokenBucket& rate_limit)
+            : dl(std::move(dl)), rate_limit(rate_limit) {}
+        std::shared_ptr<Datalink> dl;
+        detail::TokenBucket rate_limit;
+        std::optional<Datalink::ReplyWriter> reply; // the reply being written, which may be streamed across updates
+        const RPCModel* model = nullptr; // the model whose reply is being written, if any
+        uint32_t reply_us = 0; // time spent writing the reply, across updates
+        size_t handled = 0; // messages handled during the current update
+        bool is_drained = true; // every pending message was handled during the last update
+    };
+
+    /// Handles a single message of `link`, or resumes its streamed reply. Returns false if the link is done for this
+    /// update: its message budget is spent, its streamed reply is waiting for the outgoing buffer, or it is drained.
+    bool service(Link& link) {
+        if (link.handled >= _cfg.max_messages_per_update) return false;
+        _link = &link;
+        const auto is_serviced = (!link.reply || resume_reply(link)) && handle_message(link);
+        _link = nullptr;
+        if (!is_serviced) {
+            link.is_drained = !link.reply;
+            return false;
+        }
+        ++link.handled;
+        return true;
+    }
+
+    /// Publishes an unsolicited message on a single link. Returns nothing if the message was dropped, or whether it
+    /// was written whole.
+    template<typename F>
+    std::optional<bool> publish(Link& link, const std::string_view& module, uint32_t sequence, size_t max_size,
+                                F& write) {
+        if (link.reply) return std::nullopt; // would end up inside the streamed reply
+        const auto header_size = module.size() + Dialect::OPERANT_PUBLISH.size() + 10 /* sequence */
+                                 + Dialect::KV_SEPARATOR.size() + Dialect::REPLY_CRLF.size();
+        const auto needed = link.dl->mode() == Datalink::Mode::BINARY
+                                ? framing::cobs_max_encoded_size(BinaryDialect::HEADER_SIZE + sizeof(sequence)
+                                                                 + max_size + BinaryDialect::CRC_SIZE)
+                                      + 1
+                                : header_size + max_size;
+        if (link.dl->tx_available() < needed) return std::nullopt;
+
+        auto writer = link.dl->publish_writer(module, _rpc_factory.module_id(module), sequence);
+        write(static_cast<ReplyWriter&>(writer));
+        writer.finalize();
+        return !writer.is_truncated();
+    }
 
-        auto reply_error = [&](const auto& error_source) {
-            _dl->write_message(
-                Message("BAD_MESSAGE", Dialect::OPERANT_REPLY, magic_enum::enum_name(error_source.error_value())));
+    /// Returns true if `link` may invoke an RPC of `model` now. Safety requests are always admitted, though they spend
+    /// a token if one is left; bulk requests are only admitted while the bucket is at least half full.
+    bool admit(Link& link, const RPCModel& model) const {
+        switch (model.priority()) {
+            case RPCModel::Priority::SAFETY: link.rate_limit.take(); return true;
+            case RPCModel::Priority::NORMAL: return link.rate_limit.take();
+            case RPCModel::Priority::BULK: // half full, counting the token taken
+                return link.rate_limit.take(std::max(0.f, float(_cfg.rate_limit_burst) / 2 - 1));
+        }
+        return false;
+    }
+
+    /// Invokes `rpc`, writing its reply into the link's reply, or replies `BUSY` if the link is over its rate limit or
+    /// only tickets are served
+    void invoke(Link& link, const RPC& rpc) {
+        if ((_is_serving_tickets && !is_ticket_poll(rpc)) || !admit(link, rpc.model)) {
+            link.reply->set_status(RPCResult::Status::BUSY);
+            return;
+        }
+        const auto start = HAL::micros();
+        _reply_cache.invoke(rpc, *link.reply);
+        link.model = &rpc.model;
+        link.reply_us = (HAL::micros() - start).raw<uint32_t>();
+    }
+
+    static bool is_ticket_poll(const RPC& rpc) { return rpc.module == "Prompt" && rpc.model.name() == "ticket"; }
+
+    /// Handles a single message, if one is pending. Returns false if no message was pending.
+    bool handle_message(Link& link) {
+        link.dl->pull(); // pull messages from the Datalink's stream (such as UART) into its buffer
+        return link.dl->mode() == Datalink::Mode::BINARY ? handle_frame(link) : handle_line(link);
+    }
+
+    /// Handles a single line in the text dialect. A line holds a single request, or a batch of requests separated by
+    /// `BATCH_SEPARATOR`; a batch is handled in order and replied to in a single line.
+    bool handle_line(Link& link) {
+        auto line = link.dl->read_line();
+        if (!line) return false; // no complete line pending
+
+        auto batch = line->incoming();
+        do {
+            const auto request = IncomingMessageFactory::next_in_batch(batch);
+            handle_request(link, request, batch.empty());
+        } while (!batch.empty());
+
+        link.dl->push(); // push out the reply before the next message claims the outgoing buffer
+        return true;
+    }
+
+    /// Handles a single request in the text dialect. Only the last reply of a line is streamed across updates; the
+    /// replies before it are closed by `BATCH_SEPARATOR` and are truncated if they do not fit at once. Every reply,
+    /// errors included, echoes the request's ID if it carries a valid one.
+    void handle_request(Link& link, const std::string_view& request, bool is_last_in_line) {
+        const auto terminator = is_last_in_line ? Dialect::REPLY_CRLF : Dialect::BATCH_SEPARATOR;
+        auto reply_error = [&](const auto& error_source, const OptStringView& request_id) {
+            const auto error = magic_enum::enum_name(error_source.error_value());
+            link.dl->error_writer(error, terminator, request_id).finalize();
         };
 
         // process incoming message
-        auto message = _dl->read_message();
+        auto message = IncomingMessageFactory::from_view(request);
         if (!message) {
-            if (message.is_failed()) reply_error(message);
-            _dl->push();
+            if (message.is_failed()) reply_error(message, valid_request_id(request));
             return;
         }
 
         // process RPC
         auto rpc = _rpc_factory.from_message(*message);
         if (!rpc) {
-            if (rpc.is_failed()) reply_error(rpc);
-            _dl->push();
+            if (rpc.is_failed()) reply_error(rpc, message->request_id);
             return;
         }
 
-        // do the remote procedure call
-        auto rpc_result = rpc->invoke();
-        if (const auto reply = OutgoingMessageFactory::from_rpc_result(std::move(rpc_result), message->module); reply) {
-            _dl->write_message(*reply);
+        // do the remote procedure call, writing the reply straight into the datalink's outgoing buffer
+        spn_assert(!link.reply);
+        link.reply.emplace(*link.dl, rpc->module, Dialect::OPERANT_REPLY, std::nullopt, terminator,
+                           message->request_id);
+        invoke(link, *rpc);
+        if (!resume(link) && is_last_in_line) return; // the rest is streamed by `update()`
+        finalize_reply(link);
+    }
+
+    /// Returns the ID of a request that could not be parsed, if it carries a valid one
+    static OptStringView valid_request_id(std::string_view request) {
+        const auto request_id = IncomingMessageFactory::split_request_id(request);
+        if (!request_id || !Dialect::is_valid_request_id(*request_id)) return std::nullopt;
+        return request_id;
+    }
+
+    /// Handles a single frame in the binary dialect.
+    bool handle_frame(Link& link) {
+        auto reply_error = [&](uint8_t module_id, uint8_t command_id, const auto& error_source) {
+            link.dl->write_frame(BinaryDialect::FrameType::ERROR, module_id, command_id,
+                                 magic_enum::enum_name(error_source.error_value()));
+            link.dl->push();
+        };
+
+        auto frame = link.dl->read_frame();
+        if (!frame) {
+            if (!frame.is_failed()) return false; // no complete frame pending
+            reply_error(BinaryDialect::UNKNOWN_ID, BinaryDialect::UNKNOWN_ID, frame);
+            return true;
+        }
+
+        auto rpc = _rpc_factory.from_ids(frame->module_id, frame->command_id, frame->arguments);
+        if (!rpc) {
+            if (rpc.is_failed()) reply_error(frame->module_id, frame->command_id, rpc);
+            return true;
+        }
+
+        spn_assert(!link.reply);
+        link.reply.emplace(*link.dl, frame->module_id, frame->command_id);
+        invoke(link, *rpc);
+        if (!resume(link)) return true; // the rest is streamed by `update()`
+        finalize_reply(link);
+
+        link.dl->push();
+        return true;
+    }
+
+    /// Resumes a streamed reply as the outgoing buffer drains. Returns true once the reply is complete.
+    bool resume_reply(Link& link) {
+        link.dl->push();
+        if (!resume(link)) return false;
+        finalize_reply(link);
+        link.dl->push();
+        return true;
+    }
+
+    /// Resumes a streamed reply for as long as it fits, counting the time spent towards the call. Returns true once
+    /// the reply is complete.
+    static bool resume(Link& link) {
+        const auto start = HAL::micros();
+        const auto is_complete = link.reply->resume();
+        link.reply_us += (HAL::micros() - start).raw<uint32_t>();
+        return is_complete;
+    }
+
+    /// Closes the reply and records the call in its model's metrics
+    static void finalize_reply(Link& link) {
+        const auto bytes = link.reply->finalize();
+        if (link.model) link.model->record_call(link.reply_us, bytes, link.reply->status() != RPCResult::Status::OK);
+        link.model = nullptr;
+        link.reply.reset();
+    }
+
+    /// The prompt's built-in module, negotiating the dialect spoken over the datalink.
+    std::unique_ptr<RPCRecipe> rpc_recipe() {
+        const auto switch_mode = [this](Datalink::Mode mode) {
+            spn_assert(_link); // the link the request arrived on
+            _link->dl->request_mode(mode, _cfg.binary_mode_timeout); // applied once the acknowledgement is pushed out
+            return RPCResult(RPCResult::Status::OK);
+        };
+        return std::make_unique<RPCRecipe>(RPCRecipe(
+            "Prompt", //
+            {
+                RPCModel(
+                    "binary", [switch_mode](const OptStringView&) { return switch_mode(Datalink::Mode::BINARY); },
+                    "Switch to the binary dialect; module and command IDs are listed by the usage operant"),
+                RPCModel(
+                    "text", [switch_mode](const OptStringView&) { return switch_mode(Datalink::Mode::TEXT); },
+                    "Switch to the text dialect"),
+                RPCModel::typed(
+                    "compress",
+                    [this](bool is_enabled) {
+                        spn_assert(_link); // the link the request arrived on
+                        _link->dl->set_compression(is_enabled);
+                        return RPCResult(RPCResult::Status::OK);
+                    },
+                    "Args: 1 or 0. Compresses the return values of the text replies that follow, such as "
+                    "`MOD<OK~<compressed>`"),
+                RPCModel(
+                    "ticket",
+                    [this](const OptStringView& id, ReplyWriter& reply) {
+                        auto ticket_id = RPCTicket::Id(0);
+                        const auto is_parsed =
+                            id && std::from_chars(id->data(), id->data() + id->size(), ticket_id).ec == std::errc();
+                        const auto ticket = is_parsed ? _tickets.find(ticket_id) : nullptr;
+                        if (!ticket) {
+                            reply.set_status(RPCResult::Status::BAD_INPUT);
+                            return;
+                        }
+                        ticket->write(reply);
+                    },
+                    "Args: ticket id. Replies with RUNNING|<phase>|<seconds> or DONE|<status>[|<result>]"),
+                RPCModel(
+                    "cacheStats",
+                    [this](const OptStringView& arg) {
+                        if (arg && *arg == "reset") _reply_cache.reset_stats();
+                        const auto& stats = _reply_cache.stats();
+                        return RPCResult(std::to_string(stats.hits) + std::string(Dialect::VALUE_SEPARATOR)
+                                         + std::to_string(stats.misses));
+                    },
+                    "Replies with the reply cache's hits|misses. Arg 'reset' resets them"),
+                RPCModel(
+                    "stats", [this](const OptStringView& arg, ReplyWriter& reply) { write_stats(arg, reply); },
+                    "Replies with module:command|calls|errors|min|mean|max us|reply bytes for every command called, "
+                    "the usage listing as '?', records separated by ','. Arg 'reset' resets them"),
+            }));
+    }
+
+    /// Writes the metrics of every model called since the last reset, the usage listing's included, or resets them. The
+    /// records are separated by `RECORD_SEPARATOR`, as a line ends the reply.
+    void write_stats(const OptStringView& arg, ReplyWriter& reply) {
+        if (arg) {
+            if (*arg != "reset") {
+                reply.set_status(RPCResult::Status::BAD_INPUT);
+                return;
+            }
+            _rpc_factory.usage_model().reset_metrics();
+            for (size_t module_id = 0; module_id < _rpc_factory.recipe_count(); ++module_id) {
+                for (const auto& model : _rpc_factory.recipe(module_id).models())
+                    model.reset_metrics();
+            }
+            return;
         }
 
-        _dl->push(); // push out messages queued up in the buffer
+        reply.stream([this, module_id = size_t(0), command_id = size_t(0), is_usage_written = false,
+                      is_first = true](ReplyWriter& reply) mutable {
+            if (!is_usage_written) {
+                is_usage_written = true;
+                const auto& usage = _rpc_factory.usage_model();
+                if (usage.metrics().calls > 0) {
+                    write_stats_record(reply, is_first, Dialect::OPERANT_PRINT_USAGE, usage);
+                    return true;
+                }
+            }
+            for (; module_id < _rpc_factory.recipe_count(); ++module_id, command_id = 0) {
+                const auto& recipe = _rpc_factory.recipe(module_id);
+                while (command_id < recipe.models().size()) {
+                    const auto& model = recipe.models()[command_id++];
+                    if (model.metrics().calls == 0) continue;
+                    write_stats_record(reply, is_first, recipe.module(), model);
+                    return true;
+                }
+            }
+            return false;
+        });
     }
 
-    /// Set the active datalink used by the prompt
-    void hotload_datalink(std::shared_ptr<Datalink> dl) { _dl.swap(dl); }
+    /// Writes the metrics of `model`, labelled `module:command`, or just `module` for a model in no recipe
+    static void write_stats_record(ReplyWriter& reply, bool& is_first, const std::string_view& module,
+                                   const RPCModel& model) {
+        const auto& m = model.metrics();
+        char text[72];
+        const int size = std::snprintf(text, sizeof(text), "|%lu|%lu|%lu|%lu|%lu|%llu",
+                                       static_cast<unsigned long>(m.calls), static_cast<unsigned long>(m.errors),
+                                       static_cast<unsigned long>(m.min_us), static_cast<unsigned long>(m.mean_us()),
+                                       static_cast<unsigned long>(m.max_us),
+                                       static_cast<unsigned long long>(m.reply_bytes));
+        if (!is_first) reply.write(Dialect::RECORD_SEPARATOR);
+        is_first = false;
+        reply.write(module);
+        if (!model.name().empty()) {
+            reply.write(Dialect::KV_SEPARATOR);
+            reply.write(model.name());
+        }
+        reply.write(std::string_view(text, size > 0 ? std::min<size_t>(size, sizeof(text) - 1) : 0));
+    }
 
-    /// Add an `RPCRecipe` to the prompt.
-    void hotload_rpc_recipe(std::unique_ptr<RPCRecipe> recipe) {
-        DBG("Prompt: Loading recipe: %s", std::string(recipe->module()).c_str());
-        _rpc_factory.hotload_rpc_recipe(std::move(recipe));
+    /// Publishes an update of a ticket on behalf of the module that issued it, tagged with the ticket's id
+    void publish_ticket(const RPCTicket& ticket) {
+        if (_links.empty()) return;
+        constexpr size_t max_state_size = 32; // state, status or phase and elapsed time
+        const auto max_size = max_state_size + (ticket.result.return_value ? ticket.result.return_value->size() : 0);
+        if (!publish(ticket.module, ticket.id, max_size, [&ticket](ReplyWriter& reply) { ticket.write(reply); })) {
+            WARN("Prompt: dropped update of ticket %i", ticket.id);
+        }
     }
 
-private:
     const Config _cfg;
+    bool _is_updating = false;
+    bool _is_serving_tickets = false; // only tickets are polled; see `serve_tickets()`
+    PublishListener _publish_listener;
+    StreamPoller _stream_poller;
 
     RPCFactory _rpc_factory;
-    std::shared_ptr<Datalink> _dl = nullptr;
+    RPCTicketOffice _tickets;
+    RPCReplyCache _reply_cache; // outlives the links, whose streamed replies may pin its entries
+    std::vector<std::unique_ptr<Link>> _links; // never beyond `max_datalinks`
+    size_t _first_link = 0; // the link serviced first by the next update
+    Link* _link = nullptr; // the link whose message is being handled
 };
 
 } // namespace kaskas::prompt
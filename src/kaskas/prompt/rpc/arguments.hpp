@@ -0,0 +1,133 @@
+#pragma once
+
+#include "kaskas/prompt/dialect.hpp"
+#include "kaskas/prompt/rpc/result.hpp"
+
+#include <magic_enum/magic_enum.hpp>
+#include <spine/core/utils/string.hpp>
+#include <spine/platform/hal.hpp>
+
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <optional>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace kaskas::prompt {
+
+namespace detail {
+
+template<typename T>
+struct is_optional : std::false_type {};
+template<typename T>
+struct is_optional<std::optional<T>> : std::true_type {};
+
+template<typename T>
+struct is_time : std::false_type {};
+template<>
+struct is_time<k_time_us> : std::true_type {};
+template<>
+struct is_time<k_time_ms> : std::true_type {};
+template<>
+struct is_time<k_time_s> : std::true_type {};
+template<>
+struct is_time<k_time_m> : std::true_type {};
+template<>
+struct is_time<k_time_h> : std::true_type {};
+
+template<typename T>
+constexpr bool is_unsupported_argument = !std::is_same_v<T, T>;
+
+/// The decayed parameter types of a callable, as a tuple
+template<typename F>
+struct parameters_of : parameters_of<decltype(&F::operator())> {};
+template<typename C, typename R, typename... Args>
+struct parameters_of<R (C::*)(Args...) const> {
+    using type = std::tuple<std::decay_t<Args>...>;
+};
+template<typename C, typename R, typename... Args>
+struct parameters_of<R (C::*)(Args...)> {
+    using type = std::tuple<std::decay_t<Args>...>;
+};
+
+/// Splits the next value off the arguments, leaving the remainder in `args`. Returns nothing once all are taken.
+inline OptStringView next_argument(OptStringView& args) {
+    if (!args) return std::nullopt;
+    const auto separator = args->find(Dialect::VALUE_SEPARATOR);
+    const auto value = args->substr(0, separator);
+    if (separator == std::string_view::npos) args.reset();
+    else args = args->substr(separator + Dialect::VALUE_SEPARATOR.size());
+    return value;
+}
+
+} // namespace detail
+
+/// Parses a single argument of type `T`: a `std::string_view`, `bool` (`0`, `1`, `false` or `true`), integer,
+/// floating point value, enum (by name) or `k_time_*` (a length and unit of time, such as `10s` or `1h`). Returns
+/// nothing if the text does not hold a valid `T` as a whole. Never allocates.
+template<typename T>
+std::optional<T> parse_argument(const std::string_view& text) {
+    if constexpr (std::is_same_v<T, std::string_view>) {
+        return text;
+    } else if constexpr (std::is_same_v<T, bool>) {
+        if (text == "1" || text == "true") return true;
+        if (text == "0" || text == "false") return false;
+        return std::nullopt;
+    } else if constexpr (std::is_enum_v<T>) {
+        return magic_enum::enum_cast<T>(text);
+    } else if constexpr (std::is_integral_v<T>) {
+        auto value = T{};
+        const auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (ec != std::errc() || end != text.data() + text.size()) return std::nullopt;
+        return value;
+    } else if constexpr (std::is_floating_point_v<T>) {
+        // strtof needs a terminated string, and floating point `from_chars` is missing from older toolchains
+        char terminated[24];
+        if (text.empty() || text.size() >= sizeof(terminated)) return std::nullopt;
+        text.copy(terminated, text.size());
+        terminated[text.size()] = '\0';
+        char* end = nullptr;
+        auto value = T{};
+        if constexpr (std::is_same_v<T, float>) value = std::strtof(terminated, &end);
+        else value = static_cast<T>(std::strtod(terminated, &end));
+        if (end != terminated + text.size() || !std::isfinite(value)) return std::nullopt;
+        return value;
+    } else if constexpr (detail::is_time<T>::value) {
+        const auto time = spn::core::utils::parse_time(text);
+        if (!time) return std::nullopt;
+        return std::visit([](const auto& t) { return T(t); }, *time);
+    } else {
+        static_assert(detail::is_unsupported_argument<T>, "unsupported argument type");
+    }
+}
+
+/// Parses the arguments of a request, separated by `VALUE_SEPARATOR`, into a value per element of `Tuple`. An
+/// element that is a `std::optional` may be left out, as may everything after it. Returns nothing if a value is
+/// missing or invalid, or if there are more values than elements.
+template<typename Tuple>
+std::optional<Tuple> parse_arguments(OptStringView args) {
+    auto values = Tuple{};
+    const auto parse = [&args](auto& value) {
+        using T = std::decay_t<decltype(value)>;
+        const auto text = detail::next_argument(args);
+        if constexpr (detail::is_optional<T>::value) {
+            if (!text) return true;
+            value = parse_argument<typename T::value_type>(*text);
+            return value.has_value();
+        } else {
+            if (!text) return false;
+            const auto parsed = parse_argument<T>(*text);
+            if (parsed) value = *parsed;
+            return parsed.has_value();
+        }
+    };
+    const auto is_parsed = std::apply([&parse](auto&... value) { return (parse(value) && ... && true); }, values);
+    if (!is_parsed || args) return std::nullopt;
+    return values;
+}
+
+} // namespace kaskas::prompt
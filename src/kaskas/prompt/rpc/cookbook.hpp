@@ -2,57 +2,89 @@
 
 #include "kaskas/prompt/rpc/rpc.hpp"
 
-#include <list>
-#include <set>
+#include <algorithm>
+#include <memory>
+#include <vector>
 
 namespace kaskas::prompt {
 
 /// A cookbook of RPCRecipes. To be used when directly hotloading RPCRecipes into the prompt is not feasible. For
 /// example when a module must be initialized before the prompt is ready.
+///
+/// The cookbook's table of recipes is a single block of fixed capacity, allocated once on construction. Recipes are
+/// consolidated in place and the block is released when the recipes are extracted, after which the cookbook is frozen.
 class RPCCookbook {
 public:
-    // todo: make a static version that doesnt employ a list as it causes fragmentation of heap.
-    using Recipes = std::list<std::unique_ptr<RPCRecipe>>;
+    using Recipes = std::vector<std::unique_ptr<RPCRecipe>>;
 
-    Recipes&& extract_recipes() {
+    struct Config {
+        size_t max_recipes = 32; // maximum amount of recipes that can be added before consolidation
+    };
+
+    explicit RPCCookbook(const Config& cfg) : _cfg(cfg) { _recipes.reserve(_cfg.max_recipes); }
+
+    /// Consolidates and hands over all recipes. The cookbook is frozen afterwards.
+    Recipes extract_recipes() {
+        spn_assert(!_frozen);
         consolidate_recipes();
+        _frozen = true;
         return std::move(_recipes);
     }
+
     void add_recipe(std::unique_ptr<RPCRecipe> recipe) {
-        if (recipe) _recipes.emplace_back(std::move(recipe));
+        spn_assert(!_frozen); // recipes were already handed over
+        if (!recipe) return;
+        spn_assert(_recipes.size() < _cfg.max_recipes); // never grow beyond the block allocated on construction
+        _recipes.emplace_back(std::move(recipe));
     }
 
+    bool is_frozen() const { return _frozen; }
+
 protected:
-    /// Consolidate recipes by reordering them
-    /// make sure models in recipes with the same `cmd` name are stored in the same recipe.
+    /// Consolidate recipes by reordering them in place:
+    /// make sure models in recipes with the same `module` name are stored in the same recipe.
     void consolidate_recipes() {
-        auto new_cookbook = Recipes();
+        const auto by_module = [](const std::unique_ptr<RPCRecipe>& a, const std::unique_ptr<RPCRecipe>& b) {
+            return a->module() < b->module();
+        };
 
-        // extract all names
-        std::set<std::string_view> names;
-        for (const auto& rpc_recipe : _recipes) {
-            names.insert(rpc_recipe->module());
+        // stable insertion sort; unlike std::stable_sort it does not ask for a temporary buffer
+        for (auto it = _recipes.begin(); it != _recipes.end(); ++it) {
+            std::rotate(std::upper_bound(_recipes.begin(), it, *it, by_module), it, std::next(it));
         }
 
-        for (const auto& name : names) {
-            const auto name_str = std::string(name);
-            DBG("RPCCookbook: consolidating %s", name_str.c_str());
-            RPCRecipeFactory rf(name_str);
-
-            for (auto& r : _recipes) {
-                if (r->module() == name) {
-                    for (auto& m : r->extract_models()) {
-                        DBG("-> %s", std::string(m.name()).c_str());
-                        rf.add_model(std::move(m));
-                    }
+        // fold every run of recipes sharing a module into the run's first recipe
+        auto head = _recipes.begin();
+        for (auto first = _recipes.begin(); first != _recipes.end();) {
+            const auto last = std::find_if(first, _recipes.end(), [&](const std::unique_ptr<RPCRecipe>& r) {
+                return r->module() != (*first)->module();
+            });
+
+            DBG("RPCCookbook: consolidating %s", std::string((*first)->module()).c_str());
+            auto& models = (*first)->_models;
+            size_t model_count = 0;
+            for (auto it = first; it != last; ++it)
+                model_count += (*it)->_models.size();
+            models.reserve(model_count); // one allocation per module at most
+            for (auto it = std::next(first); it != last; ++it) {
+                for (auto& m : (*it)->_models) {
+                    DBG("-> %s", std::string(m.name()).c_str());
+                    models.emplace_back(std::move(m));
                 }
+                it->reset();
             }
-            new_cookbook.emplace_back(std::move(rf.extract_recipe()));
+
+            if (head != first) *head = std::move(*first);
+            ++head;
+            first = last;
         }
-        _recipes.swap(new_cookbook); // overwrite old cookbook
+        _recipes.erase(head, _recipes.end());
     }
 
 private:
+    const Config _cfg;
+
     Recipes _recipes;
+    bool _frozen = false;
 };
 } // namespace kaskas::prompt
@@ -0,0 +1,292 @@
+#pragma once
+
+#include "kaskas/prompt/dialect.hpp"
+#include "kaskas/prompt/rpc/model.hpp"
+#include "kaskas/prompt/rpc/recipe.hpp"
+
+#include <spine/core/debugging.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <vector>
+
+namespace kaskas::prompt {
+
+namespace detail {
+/// Seeded FNV-1a over a two-part key. The separator is hashed as well so that {"ab", "c"} and {"a", "bc"} differ.
+/// The hash is finalized with an avalanche, as FNV-1a's low bits, which pick the slot in a small table, depend on
+/// too few of the key's bits: its lowest bit is the parity of the characters' lowest bits, whatever the seed.
+constexpr uint32_t fnv1a(const std::string_view& first, const std::string_view& second, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ (seed * 16777619u);
+    const auto mix = [&hash](const std::string_view& s) {
+        for (const auto c : s) {
+            hash ^= static_cast<uint8_t>(c);
+            hash *= 16777619u;
+        }
+    };
+    mix(first);
+    hash ^= static_cast<uint8_t>(Dialect::KV_SEPARATOR[0]);
+    hash *= 16777619u;
+    mix(second);
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+} // namespace detail
+
+/// A minimal perfect hash table over (at most) two-part string keys, built once using hash-and-displace (CHD).
+/// A lookup costs two hashes and a single key comparison, regardless of the amount of keys in the table. Should no seed
+/// out of `max_seeds` yield a perfect hash within `max_trials` displacements in total, the table falls back to a linear
+/// scan of its keys.
+template<typename T>
+class PerfectHashTable {
+public:
+    static constexpr uint32_t default_max_trials = 1u << 15; // bounds the time spent building, across all seeds
+
+    explicit PerfectHashTable(uint32_t max_trials = default_max_trials) : _max_trials(max_trials) {}
+
+    struct Key {
+        std::string_view first;
+        std::string_view second;
+
+        bool operator==(const Key& other) const { return first == other.first && second == other.second; }
+        bool operator<(const Key& other) const {
+            return first != other.first ? first < other.first : second < other.second;
+        }
+    };
+
+    struct Entry {
+        Key key;
+        T value;
+    };
+
+    /// Build the table from the provided entries. Duplicate keys are dropped; the first occurence wins.
+    void build(std::vector<Entry>&& entries) {
+        std::stable_sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.key < b.key; });
+        entries.erase(std::unique(entries.begin(), entries.end(),
+                                  [](const Entry& a, const Entry& b) {
+                                      if (!(a.key == b.key)) return false;
+                                      WARN("PerfectHashTable: dropping duplicate key: {%s:%s}",
+                                           std::string(b.key.first).c_str(), std::string(b.key.second).c_str());
+                                      return true;
+                                  }),
+                      entries.end());
+
+        clear();
+        if (entries.empty()) return;
+
+        const auto size = entries.size();
+        const auto bucket_count = size / 2 + 1;
+
+        auto scratch = Scratch{};
+        scratch.key_buckets.resize(size);
+        scratch.bucket_keys.resize(size);
+        scratch.bucket_begin.resize(bucket_count + 1);
+        scratch.order.resize(bucket_count);
+        scratch.occupied.resize(size);
+        scratch.displacements.resize(bucket_count);
+        scratch.placement.resize(size);
+        scratch.candidate_slots.reserve(size);
+
+        for (uint32_t seed = 0; seed < max_seeds && _trials < _max_trials; ++seed) {
+            if (try_build(entries, seed, scratch)) return;
+            DBG("PerfectHashTable: reseeding after failed build with seed %u", seed);
+        }
+
+        WARN("PerfectHashTable: no perfect hash found for %i keys in %u trials, falling back to a linear lookup",
+             int(size), unsigned(_trials));
+        _slots = std::move(entries);
+    }
+
+    /// Returns the value stored for the provided key, if any.
+    std::optional<T> find(const Key& key) const {
+        if (_slots.empty()) return std::nullopt;
+        if (!is_perfect()) {
+            const auto entry =
+                std::find_if(_slots.begin(), _slots.end(), [&key](const Entry& e) { return e.key == key; });
+            return entry != _slots.end() ? std::optional<T>(entry->value) : std::nullopt;
+        }
+        const auto bucket = detail::fnv1a(key.first, key.second, _seed) % _displacements.size();
+        const auto slot = detail::fnv1a(key.first, key.second, _displacements[bucket]) % _slots.size();
+        const auto& entry = _slots[slot];
+        if (entry.key == key) return entry.value;
+        return std::nullopt;
+    }
+
+    size_t size() const { return _slots.size(); }
+    bool empty() const { return _slots.empty(); }
+
+    /// Returns whether lookups are hashed, rather than a linear scan after every seed failed to build
+    bool is_perfect() const { return !_displacements.empty(); }
+
+    /// Returns the amount of displacements tried by the last build; at most `max_trials`
+    uint32_t trials() const { return _trials; }
+
+    void clear() {
+        _slots.clear();
+        _displacements.clear();
+        _seed = 0;
+        _trials = 0;
+    }
+
+private:
+    static constexpr uint32_t max_seeds = 8;
+
+    /// The storage of a build, allocated once and reused by every seed tried
+    struct Scratch {
+        std::vector<uint32_t> key_buckets; // the bucket of every key
+        std::vector<uint16_t> bucket_keys; // the keys, ordered by bucket
+        std::vector<uint16_t> bucket_begin; // the first key of every bucket in `bucket_keys`, and one past the last
+        std::vector<uint16_t> order;
+        std::vector<bool> occupied;
+        std::vector<uint32_t> displacements;
+        std::vector<uint16_t> placement;
+        std::vector<size_t> candidate_slots;
+    };
+
+    bool try_build(const std::vector<Entry>& entries, uint32_t seed, Scratch& s) {
+        const auto size = entries.size();
+        const auto bucket_count = s.order.size();
+
+        // distribute the entries over the buckets: count the keys of every bucket, then place them back to front
+        std::fill(s.bucket_begin.begin(), s.bucket_begin.end(), 0);
+        for (size_t i = 0; i < size; ++i) {
+            const auto& key = entries[i].key;
+            s.key_buckets[i] = detail::fnv1a(key.first, key.second, seed) % bucket_count;
+            ++s.bucket_begin[s.key_buckets[i]];
+        }
+        for (size_t b = 1; b < bucket_count; ++b)
+            s.bucket_begin[b] += s.bucket_begin[b - 1];
+        s.bucket_begin[bucket_count] = size;
+        for (size_t i = size; i-- > 0;)
+            s.bucket_keys[--s.bucket_begin[s.key_buckets[i]]] = i;
+        const auto bucket_size = [&s](size_t b) { return s.bucket_begin[b + 1] - s.bucket_begin[b]; };
+
+        // place the largest buckets first while the table is still mostly empty
+        for (size_t i = 0; i < bucket_count; ++i)
+            s.order[i] = i;
+        std::stable_sort(s.order.begin(), s.order.end(),
+                         [&](uint16_t a, uint16_t b) { return bucket_size(a) > bucket_size(b); });
+
+        std::fill(s.occupied.begin(), s.occupied.end(), false);
+        std::fill(s.displacements.begin(), s.displacements.end(), 0);
+
+        // a bucket that fails to place after a few times the table's size in tries is left to the next seed
+        const auto max_displacements = 4 * size + 16;
+        for (const auto b : s.order) {
+            const auto bucket_first = s.bucket_keys.begin() + s.bucket_begin[b];
+            const auto bucket_last = s.bucket_keys.begin() + s.bucket_begin[b + 1];
+            if (bucket_first == bucket_last) break; // sorted by size; the rest is empty as well
+
+            bool placed = false;
+            for (uint32_t d = 1; d <= max_displacements && !placed; ++d) {
+                if (_trials >= _max_trials) return false;
+                ++_trials;
+                s.candidate_slots.clear();
+                placed = true;
+                for (auto i = bucket_first; i != bucket_last; ++i) {
+                    const auto& key = entries[*i].key;
+                    const auto slot = detail::fnv1a(key.first, key.second, d) % size;
+                    if (s.occupied[slot]
+                        || std::find(s.candidate_slots.begin(), s.candidate_slots.end(), slot)
+                               != s.candidate_slots.end()) {
+                        placed = false;
+                        break;
+                    }
+                    s.candidate_slots.push_back(slot);
+                }
+                if (placed) {
+                    s.displacements[b] = d;
+                    for (size_t k = 0; k < s.candidate_slots.size(); ++k) {
+                        s.occupied[s.candidate_slots[k]] = true;
+                        s.placement[s.candidate_slots[k]] = bucket_first[k];
+                    }
+                }
+            }
+            if (!placed) return false;
+        }
+
+        _slots.clear();
+        _slots.reserve(size);
+        for (size_t slot = 0; slot < size; ++slot) {
+            _slots.push_back(entries[s.placement[slot]]);
+        }
+        _displacements = std::move(s.displacements);
+        _seed = seed;
+        return true;
+    }
+
+    const uint32_t _max_trials;
+
+    std::vector<Entry> _slots;
+    std::vector<uint32_t> _displacements;
+    uint32_t _seed = 0;
+    uint32_t _trials = 0;
+};
+
+/// A dispatch index over the models of a set of `RPCRecipe`s. Built once all recipes are loaded, after which looking up
+/// a module or a module's command no longer depends on the amount of loaded recipes and models.
+class RPCIndex {
+public:
+    using Recipes = std::vector<std::unique_ptr<RPCRecipe>>;
+
+    /// (Re)builds the index. The recipes must outlive the index and must not be modified while the index is in use.
+    void build(const Recipes& recipes) {
+        using RecipeTable = PerfectHashTable<const RPCRecipe*>;
+        using ModelTable = PerfectHashTable<const RPCModel*>;
+
+        size_t model_count = 0;
+        for (const auto& r : recipes) {
+            model_count += r->models().size();
+        }
+
+        std::vector<RecipeTable::Entry> recipe_entries;
+        recipe_entries.reserve(recipes.size());
+        std::vector<ModelTable::Entry> model_entries;
+        model_entries.reserve(model_count);
+
+        for (const auto& r : recipes) {
+            recipe_entries.push_back({{r->module(), {}}, r.get()});
+            for (const auto& m : r->models()) {
+                model_entries.push_back({{r->module(), m.name()}, &m});
+            }
+        }
+
+        _recipes.build(std::move(recipe_entries));
+        _models.build(std::move(model_entries));
+        _is_built = true;
+        DBG("RPCIndex: indexed %i recipes and %i models", int(_recipes.size()), int(_models.size()));
+    }
+
+    /// Marks the index as stale, for example after hotloading another recipe.
+    void invalidate() {
+        _recipes.clear();
+        _models.clear();
+        _is_built = false;
+    }
+
+    bool is_built() const { return _is_built; }
+    size_t recipe_count() const { return _recipes.size(); }
+    size_t model_count() const { return _models.size(); }
+
+    /// Returns the recipe for the provided module, or nullptr if no such recipe is known.
+    const RPCRecipe* recipe(const std::string_view& module) const { return _recipes.find({module, {}}).value_or(nullptr); }
+
+    /// Returns the model for the provided module and command, or nullptr if no such model is known.
+    const RPCModel* model(const std::string_view& module, const std::string_view& command) const {
+        return _models.find({module, command}).value_or(nullptr);
+    }
+
+private:
+    PerfectHashTable<const RPCRecipe*> _recipes;
+    PerfectHashTable<const RPCModel*> _models;
+    bool _is_built = false;
+};
+
+} // namespace kaskas::prompt
@@ -1,22 +1,109 @@
 #pragma once
 
+#include "kaskas/core/inline_function.hpp"
 #include "kaskas/prompt/dialect.hpp"
 #include "kaskas/prompt/message/message.hpp"
+#include "kaskas/prompt/rpc/arguments.hpp"
+#include "kaskas/prompt/rpc/reply_writer.hpp"
 #include "kaskas/prompt/rpc/result.hpp"
 
 #include <spine/core/debugging.hpp>
 #include <spine/platform/hal.hpp>
 #include <spine/structure/result.hpp>
 
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
 namespace kaskas::prompt {
 
 /// A model of a remote executable procedure call.
+///
+/// A procedure either writes its reply into a `ReplyWriter`, or returns an `RPCResult`:
+///   RPCModel("getFoo", [this](const OptStringView& arg, ReplyWriter& reply) { reply.write(foo()); })
+///   RPCModel("getBar", [this](const OptStringView& arg) { return RPCResult(std::to_string(bar())); })
+/// The latter is adapted to the former. A procedure taking typed parameters is bound with `RPCModel::typed()`:
+///   RPCModel::typed("setFoo", [this](float foo, std::optional<k_time_s> delay) { return set_foo(foo, delay); })
+///
+/// A model whose reply does not depend on the moment it is called may declare a `CachePolicy`, after which the prompt
+/// serves its reply to requests without arguments from the `RPCReplyCache`. A model's `Priority` decides which requests
+/// the prompt rejects first when a host sends more than its rate limit. The prompt records the `Metrics` of every
+/// call of a model.
 class RPCModel {
 public:
+    /// Under load, bulk requests are rejected first and safety requests never.
+    enum class Priority : uint8_t { SAFETY, NORMAL, BULK };
+
+    /// How long the reply of a request without arguments may be served from the reply cache.
+    struct CachePolicy {
+        enum class Lifetime : uint8_t { NONE, CONSTANT, TTL };
+        Lifetime lifetime = Lifetime::NONE;
+        k_time_ms ttl = k_time_ms(0); // time to live of a `TTL` reply
+
+        static CachePolicy none() { return {}; }
+        static CachePolicy constant() { return {Lifetime::CONSTANT}; } // never changes after boot
+        static CachePolicy time_to_live(k_time_ms ttl) { return {Lifetime::TTL, ttl}; }
+
+        bool is_cached() const { return lifetime != Lifetime::NONE; }
+    };
+
+    /// The execution metrics of a model, over every call since the last reset
+    struct Metrics {
+        uint32_t calls = 0;
+        uint32_t errors = 0; // calls replied to with a status other than OK
+        uint32_t min_us = 0; // execution time of the fastest call, including any streaming of its reply
+        uint32_t max_us = 0;
+        uint64_t total_us = 0;
+        uint64_t reply_bytes = 0; // bytes written into the outgoing buffer, headers included
+
+        uint32_t mean_us() const { return calls > 0 ? static_cast<uint32_t>(total_us / calls) : 0; }
+
+        void record(uint32_t us, size_t bytes, bool is_error) {
+            min_us = calls == 0 ? us : std::min(min_us, us);
+            max_us = std::max(max_us, us);
+            total_us += us;
+            reply_bytes += bytes;
+            errors += is_error;
+            ++calls;
+        }
+    };
+
+    /// The procedure invoked by the model. Stored inline; captures beyond `max_capture_size` fail to compile.
+    static constexpr size_t max_capture_size = 4 * sizeof(void*);
+    using Call = core::InlineFunction<void(const OptStringView&, ReplyWriter&), max_capture_size>;
+
     // RPCModel(const std::string& name) : _name(name) {}
-    RPCModel(const std::string& name, const std::function<RPCResult(const OptStringView&)>& call,
-             const std::string& help = "")
-        : _name(name), _call(call), _help(help) {}
+    RPCModel(const std::string& name, const Call& call, const std::string& help = "",
+             const CachePolicy& cache_policy = CachePolicy::none(), Priority priority = Priority::NORMAL)
+        : _name(name), _help(help), _call(call), _cache_policy(cache_policy), _priority(priority) {}
+
+    template<typename F, typename = std::enable_if_t<std::is_invocable_r_v<RPCResult, F&, const OptStringView&>>>
+    RPCModel(const std::string& name, F&& call, const std::string& help = "",
+             const CachePolicy& cache_policy = CachePolicy::none(), Priority priority = Priority::NORMAL)
+        : RPCModel(name,
+                   Call([call = std::forward<F>(call)](const OptStringView& value, ReplyWriter& reply) mutable {
+                       reply.write_result(call(value));
+                   }),
+                   help, cache_policy, priority) {}
+
+    /// Returns a model whose procedure takes typed parameters instead of the raw arguments: see `parse_arguments()`.
+    /// A request whose arguments do not parse is replied to with `BAD_INPUT`, without invoking the procedure.
+    template<typename F>
+    static RPCModel typed(const std::string& name, F&& call, const std::string& help = "",
+                          const CachePolicy& cache_policy = CachePolicy::none(), Priority priority = Priority::NORMAL) {
+        using Parameters = typename detail::parameters_of<std::decay_t<F>>::type;
+        return RPCModel(name,
+                        Call([call = std::forward<F>(call)](const OptStringView& value, ReplyWriter& reply) mutable {
+                            auto arguments = parse_arguments<Parameters>(value);
+                            if (!arguments) {
+                                reply.set_status(RPCResult::Status::BAD_INPUT);
+                                return;
+                            }
+                            reply.write_result(std::apply(call, std::move(*arguments)));
+                        }),
+                        help, cache_policy, priority);
+    }
 
     /// Returns the name of the RPC
     const std::string_view name() const { return _name; }
@@ -24,14 +111,37 @@ public:
     /// Returns the help string of the RPC
     const std::string_view help() const { return _help; }
 
+    /// Returns how long the RPC's reply may be served from the reply cache
+    const CachePolicy& cache_policy() const { return _cache_policy; }
+
+    /// Returns the priority class of the RPC
+    Priority priority() const { return _priority; }
+
+    /// Returns the execution metrics of the RPC
+    const Metrics& metrics() const { return _metrics; }
+
+    /// Records a call of the RPC that took `us` microseconds and produced a reply of `bytes`
+    void record_call(uint32_t us, size_t bytes, bool is_error) const { _metrics.record(us, bytes, is_error); }
+    void reset_metrics() const { _metrics = {}; }
+
+    /// Invoke the RPC, writing the reply into the provided writer
+    void call(const OptStringView& value, ReplyWriter& reply) const { _call(value, reply); }
+
     /// Invoke the RPC
-    RPCResult call(const OptStringView& value) const { return std::move(_call(value)); }
+    RPCResult call(const OptStringView& value) const {
+        auto reply = StringReplyWriter();
+        _call(value, reply);
+        return std::move(reply).result();
+    }
 
 private:
-    const std::string _name;
-    const std::string _help;
-    const std::function<RPCResult(const OptStringView&)>
-        _call; // todo: it would be lovely to burry this heap greedy std::function
+    // not const, so that models can be moved instead of copied when recipes are consolidated
+    std::string _name;
+    std::string _help;
+    Call _call;
+    CachePolicy _cache_policy;
+    Priority _priority;
+    mutable Metrics _metrics; // mutable: recipes hand out their models as const
 };
 
 } // namespace kaskas::prompt
@@ -18,6 +18,7 @@
 namespace kaskas::prompt {
 
 class RPCRecipeFactory;
+class RPCCookbook;
 
 /// A recipe of RPCModels
 class RPCRecipe {
@@ -46,6 +47,7 @@ private:
     std::vector<RPCModel> _models;
 
     friend RPCRecipeFactory;
+    friend RPCCookbook;
 };
 
 /// A factory for building RPCRecipes from RPCModels
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "kaskas/core/allocation_tracker.hpp"
+#include "kaskas/prompt/rpc/model.hpp"
+#include "kaskas/prompt/rpc/reply_writer.hpp"
+#include "kaskas/prompt/rpc/result.hpp"
+#include "kaskas/prompt/rpc/rpc.hpp"
+
+#include <spine/core/debugging.hpp>
+#include <spine/structure/time/timers.hpp>
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kaskas::prompt {
+
+/// Keeps the serialized replies of models that declare a `CachePolicy`, so that a request without arguments is served
+/// without invoking its model. A reply is kept per dialect, as a binary dialect writes floating point values as raw
+/// bytes.
+///
+/// The cache has a fixed amount of entries, claimed round-robin once all are taken. A cached reply is streamed straight
+/// from its entry, which is pinned for as long as any link streams it: a pinned entry is neither overwritten nor
+/// evicted, so a cached reply may be streamed while other requests, on this or another link, are served. A refreshed
+/// reply takes another entry instead, and the pinned one is released once streamed. Only when every entry is pinned is
+/// a reply served uncached, which truncates a return value that does not fit the outgoing buffer. A link streams a
+/// single reply at a time, so this only happens with fewer entries than datalinks.
+///
+/// A model that streams its reply through `ReplyWriter::stream()` is never cached, as that would build the reply in
+/// memory after all: its reply is streamed straight into the link's writer.
+class RPCReplyCache {
+public:
+    struct Config {
+        size_t max_entries = 8; // at least the amount of datalinks; see above
+    };
+
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+    };
+
+    explicit RPCReplyCache(const Config& cfg) : _cfg(cfg) { _entries.reserve(_cfg.max_entries); }
+
+    /// Invokes `rpc`, writing its reply into `reply`. A reply that may be cached is served from the cache if it is
+    /// still fresh, or is cached after invoking the RPC.
+    void invoke(const RPC& rpc, ReplyWriter& reply) {
+        const auto& policy = rpc.model.cache_policy();
+        if (!policy.is_cached() || rpc.value || _cfg.max_entries == 0) {
+            rpc.invoke(reply);
+            return;
+        }
+
+        const auto raw_floats = reply.writes_raw_floats();
+        auto entry = find(rpc.model, raw_floats);
+        if (entry && is_fresh(*entry, policy)) {
+            const auto allocations = core::AllocationScope(rpc.module, rpc.model.name());
+            ++_stats.hits;
+            serve(*entry, reply);
+            return;
+        }
+        ++_stats.misses;
+
+        auto writer = StringReplyWriter(raw_floats);
+        rpc.invoke(writer);
+        if (writer.is_streaming()) {
+            if (entry) entry->model = nullptr;
+            std::move(writer).forward(reply); // not collected; see above
+            return;
+        }
+
+        if (entry && entry->streams > 0) {
+            entry->model = nullptr; // left to the replies streaming it
+            entry = nullptr;
+        }
+        if (!entry) entry = claim(rpc.model, raw_floats);
+        if (!entry) {
+            std::move(writer).forward(reply); // every entry is being streamed
+            return;
+        }
+
+        const auto result = std::move(writer).result();
+
+        entry->status = result.status;
+        entry->has_return_value = bool(result.return_value);
+        entry->return_value.assign(result.return_value ? *result.return_value : std::string());
+        entry->since_stored.reset();
+        serve(*entry, reply);
+    }
+
+    /// Drops every cached reply, such as when the set of models changes
+    void clear() {
+        for (auto& entry : _entries)
+            entry.model = nullptr;
+    }
+
+    const Stats& stats() const { return _stats; }
+    void reset_stats() { _stats = {}; }
+
+private:
+    struct Entry {
+        const RPCModel* model = nullptr; // nullptr if the entry holds no reply
+        bool raw_floats = false;
+        RPCResult::Status status = RPCResult::Status::OK;
+        bool has_return_value = false;
+        std::string return_value;
+        spn::structure::time::Timer since_stored;
+        size_t streams = 0; // replies being streamed from `return_value`; see `Pin`
+    };
+
+    /// Counts a reply streamed from an entry for as long as the generator streaming it lives
+    class Pin {
+    public:
+        explicit Pin(Entry& entry) : _entry(&entry) { ++_entry->streams; }
+        Pin(const Pin& other) : Pin(*other._entry) {}
+        Pin& operator=(const Pin&) = delete;
+        ~Pin() { --_entry->streams; }
+
+    private:
+        Entry* _entry;
+    };
+
+    Entry* find(const RPCModel& model, bool raw_floats) {
+        for (auto& entry : _entries) {
+            if (entry.model == &model && entry.raw_floats == raw_floats) return &entry;
+        }
+        return nullptr;
+    }
+
+    /// Returns an entry for the reply of `model`, evicting another if need be; nullptr if every entry is pinned
+    Entry* claim(const RPCModel& model, bool raw_floats) {
+        Entry* entry = nullptr;
+        for (auto& e : _entries) {
+            if (!e.model && e.streams == 0) entry = &e;
+        }
+        if (!entry && _entries.size() < _cfg.max_entries) entry = &_entries.emplace_back();
+        for (size_t i = 0; !entry && i < _entries.size(); ++i) {
+            auto& e = _entries[_next_eviction];
+            _next_eviction = (_next_eviction + 1) % _entries.size();
+            if (e.streams == 0) entry = &e;
+        }
+        if (!entry) return nullptr;
+        entry->model = &model;
+        entry->raw_floats = raw_floats;
+        return entry;
+    }
+
+    static bool is_fresh(Entry& entry, const RPCModel::CachePolicy& policy) {
+        if (policy.lifetime == RPCModel::CachePolicy::Lifetime::CONSTANT) return true;
+        return entry.since_stored.time_since_last(false) < policy.ttl;
+    }
+
+    /// Writes a cached reply, a chunk at a time; the reply may be larger than the outgoing buffer. The entry is pinned
+    /// until the reply is complete or abandoned.
+    static void serve(Entry& entry, ReplyWriter& reply) {
+        reply.set_status(entry.status);
+        if (!entry.has_return_value) return;
+        reply.stream([pin = Pin(entry), value = std::string_view(entry.return_value),
+                      offset = size_t(0)](ReplyWriter& reply) mutable {
+            const auto chunk = value.substr(offset, ReplyWriter::max_chunk_size);
+            reply.write(chunk);
+            offset += chunk.size();
+            return offset < value.size();
+        });
+    }
+
+    const Config _cfg;
+
+    std::vector<Entry> _entries; // reserved on construction; never reallocates
+    size_t _next_eviction = 0;
+    Stats _stats;
+};
+
+} // namespace kaskas::prompt
@@ -0,0 +1,174 @@
+#pragma once
+
+#include "kaskas/core/inline_function.hpp"
+#include "kaskas/prompt/rpc/result.hpp"
+
+#include <spine/core/debugging.hpp>
+
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+
+namespace kaskas::prompt {
+
+/// A bounded writer into which an RPC formats its reply. Models that take a `ReplyWriter` write their return value
+/// straight into the writer's backing store (such as the `Datalink`'s outgoing buffer), instead of building an
+/// intermediary `std::string`.
+///
+/// A reply that may not fit the backing store at once is streamed instead: the model hands a generator to `stream()`,
+/// which is resumed whenever another chunk fits, for example as the outgoing buffer drains across `Prompt::update()`s.
+class ReplyWriter {
+public:
+    using Status = RPCResult::Status;
+
+    /// A generator writes at most `max_chunk_size` bytes per call, which is expected in debug builds, and returns false
+    /// once the reply is complete.
+    static constexpr size_t max_chunk_size = 80;
+    using Generator = core::InlineFunction<bool(ReplyWriter&), 4 * sizeof(void*)>;
+
+    virtual ~ReplyWriter() = default;
+
+    /// Sets the status of the reply. Must be called before the return value is written.
+    void set_status(Status status) {
+        spn_expect(!_has_return_value); // status is already out the door
+        _status = status;
+    }
+    Status status() const { return _status; }
+
+    /// Appends a fragment to the reply's return value. A fragment that does not fit is dropped as a whole and truncates
+    /// the reply: every subsequent write is dropped as well. Returns false if the fragment was dropped.
+    bool write(const std::string_view& fragment) {
+        if (_is_truncated) return false;
+        if (!_has_return_value) {
+            if (!begin_return_value(fragment.size())) return truncate();
+            _has_return_value = true;
+        }
+        if (fragment.size() > available()) return truncate();
+        sink(fragment);
+        _bytes_written += fragment.size();
+        return true;
+    }
+
+    /// Appends a floating point value with the provided amount of decimals. Writers for a binary dialect write the raw
+    /// IEEE-754 bytes instead, in the byte order of the platform (little-endian on all supported targets).
+    bool write(float value, int decimals = 6) {
+        if (raw_floats()) {
+            char raw[sizeof(float)];
+            std::memcpy(raw, &value, sizeof(float));
+            return write(std::string_view(raw, sizeof(raw)));
+        }
+
+        std::array<char, 32> buffer{};
+        const int written = std::snprintf(buffer.data(), buffer.size(), "%.*f", decimals, static_cast<double>(value));
+        spn_expect(written > 0 && written < static_cast<int>(buffer.size()));
+        if (written <= 0 || written >= static_cast<int>(buffer.size())) return truncate();
+        return write(std::string_view(buffer.data(), written));
+    }
+
+    /// Writes a complete `RPCResult`. This adapts models returning an `RPCResult` to a `ReplyWriter`.
+    void write_result(const RPCResult& result) {
+        set_status(result.status);
+        if (result.return_value) write(*result.return_value);
+    }
+
+    /// Hands the remainder of the reply to `generator`. Its captures must outlive the request's arguments. Until the
+    /// reply is complete, unsolicited messages on its link are dropped rather than queued; see `Prompt::publish()`.
+    void stream(Generator generator) {
+        spn_expect(!_generator); // a reply has a single generator
+        _generator = std::move(generator);
+    }
+
+    /// Resumes a streamed reply for as long as whole chunks fit. Returns true once the reply is complete.
+    bool resume() {
+        while (_generator && !_is_truncated) {
+            if (available() < max_chunk_size) return false;
+            const auto bytes_written = _bytes_written;
+            const auto is_incomplete = _generator(*this);
+            spn_expect(_bytes_written - bytes_written <= max_chunk_size);
+            if (!is_incomplete) _generator = nullptr;
+        }
+        _generator = nullptr;
+        return true;
+    }
+
+    /// Abandons a streamed reply that cannot be resumed any further; an incomplete reply is truncated.
+    void cancel_stream() {
+        if (!_generator) return;
+        _generator = nullptr;
+        truncate();
+    }
+
+    /// Hands the remainder of a streamed reply over to `other`, which resumes it from here on.
+    void hand_over_stream(ReplyWriter& other) {
+        if (!_generator) return;
+        other.stream(std::move(_generator));
+        _generator = nullptr;
+    }
+
+    bool is_streaming() const { return bool(_generator); }
+    bool writes_raw_floats() const { return raw_floats(); }
+    bool has_return_value() const { return _has_return_value; }
+    bool is_truncated() const { return _is_truncated; }
+    size_t bytes_written() const { return _bytes_written; }
+
+protected:
+    /// Returns the amount of bytes of return value that can still be written.
+    virtual size_t available() const = 0;
+
+    /// Writes a fragment of the return value into the backing store. The fragment is guaranteed to fit.
+    virtual void sink(const std::string_view& fragment) = 0;
+
+    /// Called once before the first fragment of the return value is sunk. Returns false if the reply cannot be started.
+    virtual bool begin_return_value(size_t first_fragment_size) { return true; }
+
+    /// Returns true if floating point values are written as raw bytes rather than as text.
+    virtual bool raw_floats() const { return false; }
+
+private:
+    bool truncate() {
+        if (!_is_truncated) DBG("ReplyWriter: reply truncated after %i bytes", static_cast<int>(_bytes_written));
+        _is_truncated = true;
+        return false;
+    }
+
+    Status _status = Status::OK;
+    bool _has_return_value = false;
+    bool _is_truncated = false;
+    size_t _bytes_written = 0;
+    Generator _generator;
+};
+
+/// A `ReplyWriter` that collects the reply into an `RPCResult`; adapts writing models to callers wanting an
+/// `RPCResult`.
+class StringReplyWriter final : public ReplyWriter {
+public:
+    /// Floating point values are written as raw bytes if `raw_floats` is set, as they would be for a binary dialect.
+    explicit StringReplyWriter(bool raw_floats = false) : _raw_floats(raw_floats) {}
+
+    RPCResult result() && {
+        resume(); // there is always room for a streamed reply
+        return has_return_value() ? RPCResult(std::move(_return_value), status()) : RPCResult(status());
+    }
+
+    /// Writes the reply collected so far into `reply`, handing it the remainder of a streamed reply instead of
+    /// collecting it.
+    void forward(ReplyWriter& reply) && {
+        reply.set_status(status());
+        if (has_return_value()) reply.write(_return_value);
+        hand_over_stream(reply);
+    }
+
+protected:
+    size_t available() const override { return std::numeric_limits<size_t>::max(); }
+    void sink(const std::string_view& fragment) override { _return_value += fragment; }
+    bool raw_floats() const override { return _raw_floats; }
+
+private:
+    const bool _raw_floats;
+    std::string _return_value;
+};
+
+} // namespace kaskas::prompt
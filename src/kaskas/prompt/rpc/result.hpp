@@ -14,7 +14,8 @@ using OptStringView = std::optional<std::string_view>;
 
 struct RPCResult {
     RPCResult(const RPCResult& other) : return_value(other.return_value), status(other.status) {}
-    RPCResult(RPCResult&& other) noexcept : return_value(other.return_value), status(std::move(other.status)) {}
+    RPCResult(RPCResult&& other) noexcept
+        : return_value(std::move(other.return_value)), status(std::move(other.status)) {}
     RPCResult& operator=(const RPCResult& other) {
         if (this == &other) return *this;
         return_value = other.return_value;
@@ -23,11 +24,11 @@ struct RPCResult {
     }
     RPCResult& operator=(RPCResult&& other) noexcept {
         if (this == &other) return *this;
-        return_value = other.return_value;
+        return_value = std::move(other.return_value);
         status = std::move(other.status);
         return *this;
     }
-    enum class Status { UNDEFINED, OK, BAD_INPUT, BAD_RESULT };
+    enum class Status { UNDEFINED, OK, BAD_INPUT, BAD_RESULT, BUSY }; // BUSY: rejected by the prompt's rate limiter
 
     explicit RPCResult(OptString&& return_value) : return_value(std::move(return_value)), status(Status::OK) {}
     explicit RPCResult(OptString&& return_value, Status status)
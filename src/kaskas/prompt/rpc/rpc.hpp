@@ -1,7 +1,10 @@
 #pragma once
 
+#include "kaskas/core/allocation_tracker.hpp"
+#include "kaskas/core/inline_function.hpp"
 #include "kaskas/prompt/dialect.hpp"
 #include "kaskas/prompt/message/message.hpp"
+#include "kaskas/prompt/rpc/index.hpp"
 #include "kaskas/prompt/rpc/model.hpp"
 #include "kaskas/prompt/rpc/recipe.hpp"
 #include "kaskas/prompt/rpc/result.hpp"
@@ -10,12 +13,16 @@
 #include <spine/core/logging.hpp>
 #include <spine/platform/hal.hpp>
 #include <spine/structure/result.hpp>
+#include <spine/structure/time/timers.hpp>
 
+#include <cstdint>
+#include <cstdio>
 #include <initializer_list>
 #include <memory>
 #include <optional>
 #include <string_view>
 #include <type_traits>
+#include <vector>
 
 namespace kaskas::prompt {
 
@@ -26,18 +33,147 @@ class RPC {
 public:
     const Dialect::OP op;
     const RPCModel& model;
+    const std::string_view module; // the module replying to the call; outlives the call
 
-    const OptString value;
+    const OptStringView value; // views the request in the datalink's incoming buffer; valid during the call
 
-    RPCResult invoke() const { return model.call(value); }
+    RPCResult invoke() const {
+        const auto allocations = core::AllocationScope(module, model.name());
+        return model.call(value);
+    }
+    void invoke(ReplyWriter& reply) const {
+        const auto allocations = core::AllocationScope(module, model.name());
+        model.call(value, reply);
+    }
 
 public:
 protected:
-    RPC(Dialect::OP op, const RPCModel& model, OptString value) : op(op), model(model), value(value) {}
+    RPC(Dialect::OP op, const RPCModel& model, const std::string_view& module, const OptStringView& value)
+        : op(op), model(model), module(module), value(value) {}
 
     friend RPCFactory;
 };
 
+/// The state of a long-running operation, started by an asynchronous RPC and identified by the RPC's ticket.
+struct RPCTicket {
+    using Id = uint16_t;
+    enum class State : uint8_t { RUNNING, DONE };
+
+    Id id = 0;
+    std::string_view module; // the module that issued the ticket
+    State state = State::RUNNING;
+    std::string_view phase; // the operation's current phase, as posted by the operation
+    RPCResult result = RPCResult(RPCResult::Status::UNDEFINED); // the operation's result, once done
+    mutable spn::structure::time::Timer since_issued; // mutable: reading a timer is not const
+
+    /// Writes the ticket's state: `RUNNING|<phase>|<seconds since issued>` or `DONE|<status>[|<result>]`
+    void write(ReplyWriter& reply) const {
+        if (state == State::RUNNING) {
+            char elapsed[12];
+            const auto seconds = static_cast<long>(k_time_s(since_issued.time_since_last(false)).raw());
+            const int elapsed_size = std::snprintf(elapsed, sizeof(elapsed), "%li", seconds);
+            reply.write("RUNNING");
+            reply.write(Dialect::VALUE_SEPARATOR);
+            reply.write(phase);
+            reply.write(Dialect::VALUE_SEPARATOR);
+            reply.write(std::string_view(elapsed, elapsed_size));
+            return;
+        }
+        reply.write("DONE");
+        reply.write(Dialect::VALUE_SEPARATOR);
+        reply.write(detail::numeric_status(result.status));
+        if (result.return_value) {
+            reply.write(Dialect::VALUE_SEPARATOR);
+            reply.write(*result.return_value);
+        }
+    }
+};
+
+/// Keeps track of long-running operations started by asynchronous RPCs. Such an RPC replies with a ticket straight
+/// away, after which the operation posts its progress and final result to the ticket. The host polls the ticket, or has
+/// its updates pushed through the listener.
+class RPCTicketOffice {
+public:
+    struct Config {
+        size_t max_tickets = 4; // amount of tickets kept; those of completed operations are recycled, oldest first
+    };
+
+    using Listener = core::InlineFunction<void(const RPCTicket&)>;
+
+    explicit RPCTicketOffice(const Config& cfg) : _cfg(cfg) { _tickets.reserve(_cfg.max_tickets); }
+
+    /// Issues a ticket for an operation of `module`, whose view must outlive the ticket. Returns nothing if every
+    /// ticket is held by a running operation.
+    std::optional<RPCTicket::Id> issue(const std::string_view& module) {
+        RPCTicket* ticket = nullptr;
+        if (_tickets.size() < _cfg.max_tickets) {
+            ticket = &_tickets.emplace_back();
+        } else {
+            // ids are issued in order, so a ticket's age follows from its id; counted modulo the id's range, the age
+            // stays right once `_last_id` wraps around
+            const auto age = [this](const RPCTicket& t) { return static_cast<RPCTicket::Id>(_last_id - t.id); };
+            for (auto& t : _tickets) {
+                if (t.state == RPCTicket::State::DONE && (!ticket || age(t) > age(*ticket))) ticket = &t;
+            }
+        }
+        if (!ticket) {
+            WARN("RPCTicketOffice: no ticket available for %s", std::string(module).c_str());
+            return std::nullopt;
+        }
+
+        if (++_last_id == 0) ++_last_id; // zero is never issued
+        *ticket = RPCTicket{.id = _last_id, .module = module};
+        ticket->since_issued.reset();
+        return ticket->id;
+    }
+
+    /// Posts the current phase of a running operation. The phase's view must outlive the ticket.
+    void post_progress(RPCTicket::Id id, const std::string_view& phase) {
+        auto ticket = find_running(id);
+        if (!ticket || ticket->phase == phase) return;
+        ticket->phase = phase;
+        notify(*ticket);
+    }
+
+    /// Posts the final result of an operation, after which its ticket may be recycled.
+    void complete(RPCTicket::Id id, RPCResult&& result) {
+        auto ticket = find_running(id);
+        if (!ticket) return;
+        ticket->state = RPCTicket::State::DONE;
+        ticket->result = std::move(result);
+        notify(*ticket);
+    }
+
+    /// Returns the ticket with the provided id, or nullptr if no such ticket is kept.
+    const RPCTicket* find(RPCTicket::Id id) const {
+        for (const auto& t : _tickets) {
+            if (t.id == id) return &t;
+        }
+        return nullptr;
+    }
+
+    /// Sets the listener called on every update of a ticket.
+    void set_listener(Listener listener) { _listener = std::move(listener); }
+
+private:
+    RPCTicket* find_running(RPCTicket::Id id) {
+        for (auto& t : _tickets) {
+            if (t.id == id && t.state == RPCTicket::State::RUNNING) return &t;
+        }
+        return nullptr;
+    }
+
+    void notify(const RPCTicket& ticket) const {
+        if (_listener) _listener(ticket);
+    }
+
+    const Config _cfg;
+
+    std::vector<RPCTicket> _tickets;
+    RPCTicket::Id _last_id = 0;
+    Listener _listener;
+};
+
 /// Builds RPC's from stored recipes.
 class RPCFactory {
 public:
@@ -49,6 +185,8 @@ public:
 
     RPCFactory(const Config&& cfg) : _cfg(cfg) { _rpcs.reserve(_cfg.directory_size); }
     RPCFactory(const Config& cfg) : RPCFactory(Config(cfg)) {}
+    RPCFactory(const RPCFactory&) = delete; // the usage model refers back to its factory
+    RPCFactory& operator=(const RPCFactory&) = delete;
 
     spn::structure::Result<RPC, Error> from_message(const Message& msg) {
         spn_assert(msg.operant.length() == 1);
@@ -60,6 +198,7 @@ public:
             return spn::structure::Result<RPC, Error>::failed(Error::INVALID_OPERANT);
         }
         case Dialect::OP::REQUEST: {
+            if (!_index.is_built()) build_index();
             const auto recipe = recipe_for_command(msg.module);
             if (!recipe) {
                 DBG("RPCFactory: no recipe found for message: {%s}", msg.as_string().c_str());
@@ -77,56 +216,87 @@ public:
         }
     }
 
+    /// Builds an RPC for a request by numeric IDs, as used by the binary dialect. A module's ID is its position in the
+    /// order of hotloading and a command's ID is its position within the module; both are listed by `write_usage`.
+    spn::structure::Result<RPC, Error> from_ids(uint8_t module_id, uint8_t command_id, const OptStringView& arguments) {
+        if (module_id >= _rpcs.size()) {
+            DBG("RPCFactory: no recipe found for module ID %i", module_id);
+            return spn::structure::Result<RPC, Error>::failed(Error::UNKNOWN_RECIPE);
+        }
+        const auto& models = _rpcs[module_id]->models();
+        if (command_id >= models.size()) {
+            WARN("RPCFactory: No model found for command ID %i of module %s", command_id,
+                 std::string(_rpcs[module_id]->module()).c_str());
+            return spn::structure::Result<RPC, Error>::failed(Error::UNKNOWN_MODEL);
+        }
+
+        const auto opt_value = arguments && !arguments->empty() ? arguments : std::nullopt;
+        return RPC(Dialect::OP::REQUEST, models[command_id], _rpcs[module_id]->module(), opt_value);
+    }
+
+    /// Returns the numeric ID of `module`, or `UNKNOWN_ID` if no such module is loaded.
+    uint8_t module_id(const std::string_view& module) const {
+        for (size_t i = 0; i < _rpcs.size() && i < BinaryDialect::UNKNOWN_ID; ++i) {
+            if (_rpcs[i]->module() == module) return static_cast<uint8_t>(i);
+        }
+        return BinaryDialect::UNKNOWN_ID;
+    }
+
+    size_t recipe_count() const { return _rpcs.size(); }
+
+    /// Returns the recipe of `module_id`, which must be below `recipe_count()`
+    const RPCRecipe& recipe(size_t module_id) const { return *_rpcs[module_id]; }
+
+    /// Returns the model behind the usage operant, which belongs to no recipe
+    const RPCModel& usage_model() const { return _usage_model; }
+
     void hotload_rpc_recipe(std::unique_ptr<RPCRecipe> recipe) {
         spn_assert(recipe);
         _rpcs.push_back(std::move(recipe));
+        _index.invalidate();
+    }
+
+    /// Builds the dispatch index over all hotloaded recipes. Called once after hotloading has completed; if a recipe is
+    /// hotloaded afterwards the index is rebuilt on the next request.
+    void build_index() {
+        _index.build(_rpcs);
+        spn_expect(_rpcs.size() < BinaryDialect::UNKNOWN_ID); // modules beyond are unreachable by numeric ID
     }
 
 protected:
     spn::structure::Result<RPC, Error> build_rpc_for_usage(const Message& msg) {
-        static RPCModel model = {"", [&](const OptStringView&) -> RPCResult {
-                                     auto write_to_string = [&](std::string* s, bool length_only) -> size_t {
-                                         size_t len = 0;
-                                         auto put = [&](std::string_view str) {
-                                             if (!length_only && s != nullptr) {
-                                                 *s += str;
-                                             }
-                                             len += str.size();
-                                         };
-
-                                         put("[");
-                                         put(Dialect::API_VERSION);
-                                         put("]");
-                                         put("\n\r");
-
-                                         for (const auto& r : _rpcs) {
-                                             for (const auto& m : r->models()) {
-                                                 put("  ");
-                                                 put(r->module());
-                                                 put(":");
-                                                 put(m.name());
-                                                 put("\n\r");
-                                             }
-                                         }
-                                         return len;
-                                     };
-
-                                     // First pass to calculate the total length
-                                     size_t reserved_length = write_to_string(nullptr, true);
-
-                                     // Reserve capacity to avoid multiple allocations
-                                     std::string s{};
-                                     s.reserve(reserved_length);
-                                     reserved_length = s.capacity(); // for sanity checks below
-
-                                     // Second pass to build the string
-                                     write_to_string(&s, false);
-
-                                     spn_assert(s.size() <= reserved_length); // no reallocation
-                                     spn_assert(s.capacity() == reserved_length); // no reallocation
-                                     return RPCResult(s);
-                                 }};
-        return RPC(Dialect::OP::PRINT_USAGE, model, std::nullopt);
+        return RPC(Dialect::OP::PRINT_USAGE, _usage_model, Dialect::OPERANT_PRINT_USAGE, std::nullopt);
+    }
+
+    /// Writes the API version followed by every loaded module:command and its numeric IDs, one per line. The listing
+    /// is streamed a line at a time, so its length is not bound by the outgoing buffer.
+    void write_usage(ReplyWriter& reply) const {
+        reply.write("[");
+        reply.write(Dialect::API_VERSION);
+        reply.write("]");
+        reply.write("\n\r");
+
+        reply.stream([this, module_id = size_t(0), command_id = size_t(0)](ReplyWriter& reply) mutable {
+            while (module_id < _rpcs.size() && command_id >= _rpcs[module_id]->models().size()) {
+                ++module_id;
+                command_id = 0;
+            }
+            if (module_id >= _rpcs.size()) return false;
+            write_usage_line(reply, module_id, command_id++);
+            return true;
+        });
+    }
+
+    void write_usage_line(ReplyWriter& reply, size_t module_id, size_t command_id) const {
+        const auto& r = _rpcs[module_id];
+        char ids[16];
+        const int ids_size = std::snprintf(ids, sizeof(ids), " @%i.%i", int(module_id), int(command_id));
+        reply.write("  ");
+        reply.write(r->module());
+        reply.write(":");
+        reply.write(r->models()[command_id].name());
+        reply.write(std::string_view(ids, ids_size));
+        reply.write("\n\r");
     }
 
     spn::structure::Result<RPC, Error> build_rpc_for_request(const RPCRecipe& recipe, Dialect::OP optype,
@@ -135,26 +305,18 @@ protected:
             return spn::structure::Result<RPC, Error>::failed(Error::MALFORMED_MESSAGE);
         }
 
-        auto found_model = recipe.find_model_for_command(msg.cmd_or_status);
+        const auto found_model = _index.model(recipe.module(), msg.cmd_or_status);
         if (found_model == nullptr) { // no model found
             WARN("RPCFactory: No model found for msg {%s}", msg.as_string().c_str());
             return spn::structure::Result<RPC, Error>::failed(Error::UNKNOWN_MODEL);
         }
 
-        const auto opt_value =
-            msg.arguments && !msg.arguments->empty() ? std::make_optional(std::string(*msg.arguments)) : std::nullopt;
-        return RPC(optype, *found_model.value(), opt_value);
+        const auto opt_value = msg.arguments && !msg.arguments->empty() ? msg.arguments : std::nullopt;
+        return RPC(optype, *found_model, recipe.module(), opt_value);
     }
 
     std::optional<const RPCRecipe*> recipe_for_command(const std::string_view& cmd) {
-        for (const auto& recipe : _rpcs) {
-            spn_assert(recipe->module() != std::string_view{});
-            if (std::string_view(recipe->module()) == cmd) {
-                const auto cmd_str = std::string(cmd);
-                const auto recipe_cmd_str = std::string(cmd);
-                return recipe.get();
-            }
-        }
+        if (const auto recipe = _index.recipe(cmd)) return recipe;
         return {};
     }
 
@@ -162,6 +324,10 @@ private:
     const Config _cfg;
 
     std::vector<std::unique_ptr<RPCRecipe>> _rpcs;
+    RPCIndex _index;
+
+    const RPCModel _usage_model = {"", [this](const OptStringView&, ReplyWriter& reply) { write_usage(reply); }, "",
+                                   RPCModel::CachePolicy::none(), RPCModel::Priority::BULK}; // streamed
 };
 
 } // namespace kaskas::prompt
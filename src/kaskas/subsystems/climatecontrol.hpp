@@ -3,9 +3,6 @@
 #include "kaskas/component.hpp"
 #include "kaskas/events.hpp"
 #include "kaskas/io/controllers/heater.hpp"
-#include "kaskas/io/peripherals/DS18B20_Temp_Probe.hpp"
-#include "kaskas/io/peripherals/DS3231_RTC_EEPROM.hpp"
-#include "kaskas/io/peripherals/SHT31_TempHumidityProbe.hpp"
 #include "kaskas/io/peripherals/relay.hpp"
 #include "kaskas/io/providers/clock.hpp"
 
@@ -20,6 +17,11 @@
 #include <spine/platform/hal.hpp>
 #include <spine/structure/time/schedule.hpp>
 
+#include <algorithm>
+#include <cstdio>
+#include <optional>
+#include <string>
+
 namespace kaskas::component {
 
 namespace detail {
@@ -117,6 +119,7 @@ public:
     }
 
     void handle_event(const Event& event) override {
+        const auto allocations = allocation_scope(event);
         const auto now_s = [&]() {
             spn_assert(_clock.is_ready());
             const auto now_dt = _clock.now();
@@ -171,9 +174,11 @@ public:
         case Events::VentilationAutoTune: {
             if (!event.data().has_value() || event.data().value() == 0) {
                 ERR("ClimateControl: tried to start ventilation autotuning without setpoint provided");
+                complete_autotune(_ventilation_autotune_ticket, RPCResult(RPCResult::Status::BAD_INPUT));
                 return;
             }
             LOG("ClimateControl: starting ventilation autotune..");
+            post_autotune_progress(_ventilation_autotune_ticket, "tuning");
 
             const auto sp = event.data().value();
             const auto autotune_setpoint = detail::inverted(sp);
@@ -183,7 +188,10 @@ public:
 
             const auto process_getter = [&]() { return detail::inverted(_climate_humidity.value()); };
             const auto process_setter = [&](float value) { _climate_fan.fade_to(value / 100.0f); };
-            const auto process_loop = [&]() { _hws.update_all(); };
+            const auto process_loop = [&]() {
+                _hws.update_all();
+                pump_prompt();
+            };
 
             const auto tunings = _ventilation_control.autotune(
                 PID::TuneConfig{.setpoint = autotune_setpoint,
@@ -198,11 +206,13 @@ public:
             LOG("ClimateControl: Ventilation autotuning complete, results: kp: %f, ki: %f, kd: %f", tunings.Kp,
                 tunings.Ki, tunings.Kd);
             _ventilation_control.set_tunings(tunings);
+            complete_autotune(_ventilation_autotune_ticket, RPCResult(tunings_as_string(tunings)));
             break;
         }
         case Events::HeatingAutoTune: {
             if (!event.data().has_value() || event.data().value() == 0) {
                 ERR("ClimateControl: tried to start heating autotuning without setpoint provided");
+                complete_autotune(_heating_autotune_ticket, RPCResult(RPCResult::Status::BAD_INPUT));
                 return;
             }
             LOG("ClimateControl: starting heating autotune..");
@@ -213,6 +223,7 @@ public:
             _power.set_state(LogicalState::ON);
 
             // remove residual heat first
+            post_autotune_progress(_heating_autotune_ticket, "cooling down");
             _climate_fan.creep_stop();
             _climate_fan.fade_to(LogicalState::ON);
             for (auto t = _climate_temperature.value(); t > autotune_startpoint; t = _climate_temperature.value()) {
@@ -220,21 +231,27 @@ public:
                     "autotune start",
                     t, autotune_startpoint);
                 _hws.update_all();
+                pump_prompt();
                 HAL::delay(k_time_s(1));
             }
             _climate_fan.fade_to(LogicalState::OFF);
 
-            const auto process_loop = [&]() { _hws.update_all(); };
+            const auto process_loop = [&]() {
+                _hws.update_all();
+                pump_prompt();
+            };
 
+            post_autotune_progress(_heating_autotune_ticket, "tuning");
             _heating_element_fan.fade_to(LogicalState::ON);
-            _heater.autotune(PID::TuneConfig{.setpoint = autotune_setpoint,
-                                             .startpoint = autotune_startpoint,
-                                             .hysteresis = 0.03,
-                                             .satured_at_start = true,
-                                             .cycles = 10},
-                             process_loop);
+            const auto tunings = _heater.autotune(PID::TuneConfig{.setpoint = autotune_setpoint,
+                                                                  .startpoint = autotune_startpoint,
+                                                                  .hysteresis = 0.03,
+                                                                  .satured_at_start = true,
+                                                                  .cycles = 10},
+                                                  process_loop);
             adjust_power_state();
             adjust_heater_fan_state();
+            complete_autotune(_heating_autotune_ticket, RPCResult(tunings_as_string(tunings)));
             break;
         }
         case Events::HeatingFollowUp: {
@@ -290,26 +307,24 @@ public:
         auto model = std::make_unique<RPCRecipe>(RPCRecipe(
             _cfg.name,
             {
-                RPCModel("heaterAutotune",
-                         [this](const OptStringView& setpoint) {
-                             if (!setpoint) return RPCResult(RPCResult::Status::BAD_INPUT);
-                             evsys()->trigger(Events::HeatingAutoTune,
-                                              Event::Data(spn::core::utils::to_float(*setpoint)));
-                             return RPCResult(RPCResult::Status::OK);
-                         }),
+                RPCModel::typed(
+                    "heaterAutotune",
+                    [this](float setpoint) {
+                        return start_autotune(_heating_autotune_ticket, Events::HeatingAutoTune, setpoint);
+                    },
+                    "Args: setpoint. Replies with the ticket of the autotune, which completes with Kp|Ki|Kd"),
                 RPCModel("heaterStatus",
                          [this](const OptStringView&) {
                              return RPCResult(std::string(magic_enum::enum_name(_heater.state())));
                          }),
                 RPCModel("heaterSetpoint",
                          [this](const OptStringView&) { return RPCResult(std::to_string(_heater.setpoint())); }),
-                RPCModel("ventilationAutotune",
-                         [this](const OptStringView& setpoint) {
-                             if (!setpoint) return RPCResult(RPCResult::Status::BAD_INPUT);
-                             evsys()->trigger(Events::VentilationAutoTune,
-                                              Event::Data(spn::core::utils::to_float(*setpoint)));
-                             return RPCResult(RPCResult::Status::OK);
-                         }),
+                RPCModel::typed(
+                    "ventilationAutotune",
+                    [this](float setpoint) {
+                        return start_autotune(_ventilation_autotune_ticket, Events::VentilationAutoTune, setpoint);
+                    },
+                    "Args: setpoint. Replies with the ticket of the autotune, which completes with Kp|Ki|Kd"),
             }));
         return std::move(model);
     }
@@ -322,8 +337,44 @@ public:
                              }));
     }
 
+    /// Set the prompt that tracks the tickets of autotunes
+    void hotload_prompt(std::shared_ptr<Prompt> prompt) { _prompt = std::move(prompt); }
+
 private:
     using LogicalState = spn::core::LogicalState;
+    using RPCResult = prompt::RPCResult;
+    using Ticket = std::optional<prompt::RPCTicket::Id>;
+
+    /// Starts an autotune and replies with its ticket. Without a prompt to track it, the autotune runs untracked.
+    RPCResult start_autotune(Ticket& ticket, Events event, float setpoint) {
+        if (ticket) return RPCResult("Error: Autotune is already running", RPCResult::Status::BAD_RESULT);
+        if (_prompt) {
+            ticket = _prompt->tickets().issue(_cfg.name);
+            if (!ticket) return RPCResult("Error: No ticket available", RPCResult::Status::BAD_RESULT);
+        }
+        evsys()->trigger(event, Event::Data(setpoint));
+        return ticket ? RPCResult(std::to_string(*ticket)) : RPCResult(RPCResult::Status::OK);
+    }
+
+    void post_autotune_progress(const Ticket& ticket, const std::string_view& phase) {
+        if (_prompt && ticket) _prompt->tickets().post_progress(*ticket, phase);
+    }
+
+    void complete_autotune(Ticket& ticket, RPCResult&& result) {
+        if (_prompt && ticket) _prompt->tickets().complete(*ticket, std::move(result));
+        ticket.reset();
+    }
+
+    /// Keeps the ticket of a blocking operation pollable; no other RPC is invoked from within the operation
+    void pump_prompt() {
+        if (_prompt) _prompt->serve_tickets();
+    }
+
+    static std::string tunings_as_string(const PID::Tunings& tunings) {
+        char buffer[64];
+        const int size = std::snprintf(buffer, sizeof(buffer), "%f|%f|%f", tunings.Kp, tunings.Ki, tunings.Kd);
+        return std::string(buffer, size > 0 ? std::min<size_t>(size, sizeof(buffer) - 1) : 0);
+    }
 
     /// continuous checking of heating status
     void heating_control_loop() {
@@ -377,8 +428,6 @@ private:
     using EventSystem = spn::core::EventSystem;
     using IntervalTimer = spn::structure::time::IntervalTimer;
 
-    using DS18B20TempProbe = kaskas::io::DS18B20TempProbe;
-    using SHT31TempHumidityProbe = kaskas::io::SHT31TempHumidityProbe;
     using SRLatch = spn::controller::SRLatch;
 
     const Config _cfg;
@@ -402,6 +451,10 @@ private:
     io::DigitalActuator& _power;
 
     IntervalTimer _print_interval = IntervalTimer(k_time_s(10));
+
+    std::shared_ptr<Prompt> _prompt;
+    Ticket _heating_autotune_ticket;
+    Ticket _ventilation_autotune_ticket;
 };
 
 } // namespace kaskas::component
@@ -6,10 +6,13 @@
 
 #include <spine/core/meta/enum.hpp>
 
+#include <algorithm>
 #include <charconv>
 #include <cstdint>
 #include <iterator>
 #include <numeric>
+#include <string_view>
+#include <variant>
 
 namespace kaskas::component {
 
@@ -22,6 +25,7 @@ public:
     struct Config {
         k_time_s initial_warm_up_time = k_time_s(30); // don't allow timeseries access immediately after startup
         std::initializer_list<DataProviders> active_dataproviders; // dataproviders for which to print timeseries
+        k_time_ms min_publish_interval = k_time_ms(100); // shortest interval at which a subscriber is published rows
     };
 
     union Status {
@@ -35,23 +39,37 @@ public:
 
     DataAcquisition(io::HardwareStack& hws, const Config& cfg) : DataAcquisition(hws, nullptr, cfg) {}
     DataAcquisition(io::HardwareStack& hws, EventSystem* evsys, const Config& cfg)
-        : Component(evsys, hws), _cfg(std::move(cfg)), _status({}) {}
+        : Component(evsys, hws), _cfg(std::move(cfg)), _status({}) {
+        spn_assert(_cfg.active_dataproviders.size() <= 32); // a subscription selects dataproviders by bitmask
+    }
 
     void initialize() override {
         evsys()->attach(Events::DAQWarmedUp, this);
         evsys()->attach(Events::DAQTainted, this);
+        evsys()->attach(Events::DAQPublish, this);
         evsys()->schedule(evsys()->event(Events::DAQWarmedUp, k_time_s(_cfg.initial_warm_up_time)));
     }
 
     void safe_shutdown(State state) override {
         DBG("DAQ: Shutting down");
         _status.Flags.warmed_up = false;
+        _subscription.active = false;
     }
 
     void handle_event(const Event& event) override {
+        const auto allocations = allocation_scope(event);
         switch (static_cast<Events>(event.id())) {
         case Events::DAQWarmedUp: _status.Flags.warmed_up = true; break;
         case Events::DAQTainted: _status.Flags.tainted = true; break;
+        case Events::DAQPublish: {
+            const auto generation = static_cast<double>(_subscription.generation);
+            if (!_subscription.active || !event.data().has_value() || event.data().value() != generation) {
+                break; // the subscription was cancelled or replaced
+            }
+            publish_row();
+            evsys()->schedule(evsys()->event(Events::DAQPublish, _subscription.interval, Event::Data(generation)));
+            break;
+        }
         default: spn_assert(!"Event was not handled!"); break;
         }
     }
@@ -59,17 +77,40 @@ public:
     std::unique_ptr<prompt::RPCRecipe> rpc_recipe() override {
         using namespace prompt;
         auto model = std::make_unique<RPCRecipe>(
-            RPCRecipe("DAQ", //
+            RPCRecipe(rpc_module, //
                       {
                           RPCModel("getTimeSeriesColumns",
-                                   [this](const OptStringView&) { return RPCResult(datasources_as_string()); }),
+                                   [this](const OptStringView&, ReplyWriter& reply) {
+                                       stream_columns(
+                                           reply,
+                                           [](ReplyWriter& reply, DataProviders datasource) {
+                                               reply.write(magic_enum::enum_name(datasource));
+                                           },
+                                           false);
+                                   },
+                                   "", RPCModel::CachePolicy::none(), RPCModel::Priority::BULK), // streamed
                           RPCModel("getTimeSeries",
-                                   [this](const OptStringView&) {
-                                       if (!is_warmed_up())
-                                           return RPCResult("Data acquisition has not warmed up yet",
-                                                            RPCResult::Status::BAD_RESULT);
-                                       return RPCResult(timeseries_as_string());
-                                   }),
+                                   [this](const OptStringView&, ReplyWriter& reply) {
+                                       if (!is_warmed_up()) {
+                                           reply.set_status(RPCResult::Status::BAD_RESULT);
+                                           reply.write("Data acquisition has not warmed up yet");
+                                           return;
+                                       }
+                                       stream_columns(
+                                           reply,
+                                           [this](ReplyWriter& reply, DataProviders datasource) {
+                                               reply.write(_hws.analog_sensor(meta::ENUM_IDX(datasource)).value(), 3);
+                                           },
+                                           true);
+                                   },
+                                   "", RPCModel::CachePolicy::none(), RPCModel::Priority::BULK),
+                          RPCModel(
+                              "subscribe", [this](const OptStringView& args) { return subscribe(args); },
+                              "Args: publish interval and optionally the columns to publish, eg. 1s or "
+                              "500ms|CLIMATE_TEMP|SOIL_MOISTURE. Replies with the published columns"),
+                          RPCModel(
+                              "unsubscribe", [this](const OptStringView&) { return unsubscribe(); },
+                              "Replies with the amount of published and dropped rows"),
                       }));
         return std::move(model);
     }
@@ -78,7 +119,11 @@ public:
 public:
     bool is_warmed_up() const { return _status.Flags.warmed_up; }
 
-    std::string datasources_as_string() {
+    /// Set the prompt to which subscribed rows are published
+    void hotload_prompt(std::shared_ptr<Prompt> prompt) { _prompt = std::move(prompt); }
+
+    /// Returns the names of the selected active dataproviders, separated by `VALUE_SEPARATOR`
+    std::string datasources_as_string(uint32_t columns = all_columns) {
         std::string fields;
 
         size_t reserved_size = 0;
@@ -90,57 +135,141 @@ public:
         fields.reserve(reserved_size);
         reserved_size = fields.capacity(); // for sanity checks below
 
-        for (auto it = _cfg.active_dataproviders.begin(); it != _cfg.active_dataproviders.end(); ++it) {
-            const auto& datasource = *it;
-            const auto name = magic_enum::enum_name(datasource);
-            fields += name.data();
-            if (std::next(it) != _cfg.active_dataproviders.end()) fields += prompt::Dialect::VALUE_SEPARATOR;
+        size_t column = 0;
+        for (auto it = _cfg.active_dataproviders.begin(); it != _cfg.active_dataproviders.end(); ++it, ++column) {
+            if (!is_selected(columns, column)) continue;
+            if (!fields.empty()) fields += prompt::Dialect::VALUE_SEPARATOR;
+            fields += magic_enum::enum_name(*it);
         }
 
         spn_assert(fields.capacity() == reserved_size); // no reallocation
         return std::move(fields);
     }
 
-    std::string timeseries_as_string() {
-        auto timeseries_repr = [&](std::string* s, bool length_only) -> size_t {
-            size_t len = 0;
-            auto put = [&](std::string_view i) {
-                if (!length_only) {
-                    *s += i;
+    /// Writes the current value of every selected active dataprovider into the reply; see `write_separator()`
+    void write_timeseries(prompt::ReplyWriter& reply, uint32_t columns = all_columns) {
+        bool is_first = true;
+        size_t column = 0;
+        for (auto it = _cfg.active_dataproviders.begin(); it != _cfg.active_dataproviders.end(); ++it, ++column) {
+            if (!is_selected(columns, column)) continue;
+            if (!is_first) write_separator(reply, true);
+            reply.write(_hws.analog_sensor(meta::ENUM_IDX(*it)).value(), 3);
+            is_first = false;
+        }
+    }
+
+private:
+    static constexpr uint32_t all_columns = ~uint32_t(0);
+    static constexpr size_t max_value_size = 16; // a value with 3 decimals, up to +/- 99,999,999.999
+
+    static bool is_selected(uint32_t columns, size_t column) { return columns & (uint32_t(1) << column); }
+
+    /// Separates the columns of a reply by `VALUE_SEPARATOR`, unless they are numeric and written as raw floats: these
+    /// are of fixed width, and any of their bytes may equal the separator.
+    static void write_separator(prompt::ReplyWriter& reply, bool is_numeric) {
+        if (!is_numeric || !reply.writes_raw_floats()) reply.write(prompt::Dialect::VALUE_SEPARATOR);
+    }
+
+    /// Streams a column per active dataprovider into the reply, separated as by `write_separator()`, so that the reply
+    /// is not bound by the outgoing buffer. A value is read as it is written.
+    template<typename F>
+    void stream_columns(prompt::ReplyWriter& reply, F&& write_column, bool is_numeric) {
+        reply.stream([this, write_column, is_numeric, column = size_t(0)](prompt::ReplyWriter& reply) mutable {
+            if (column >= _cfg.active_dataproviders.size()) return false;
+            if (column > 0) write_separator(reply, is_numeric);
+            write_column(reply, *std::next(_cfg.active_dataproviders.begin(), column++));
+            return column < _cfg.active_dataproviders.size();
+        });
+    }
+
+    /// Subscribes the host to rows published every interval. Replaces a running subscription.
+    prompt::RPCResult subscribe(const prompt::OptStringView& args) {
+        using prompt::RPCResult;
+        if (!_prompt) return RPCResult("No prompt to publish to", RPCResult::Status::BAD_RESULT);
+        if (!is_warmed_up()) return RPCResult("Data acquisition has not warmed up yet", RPCResult::Status::BAD_RESULT);
+        if (!args) return RPCResult(RPCResult::Status::BAD_INPUT);
+
+        const auto separator = args->find(prompt::Dialect::VALUE_SEPARATOR);
+        const auto time_variant = spn::core::utils::parse_time(args->substr(0, separator));
+        if (!time_variant.has_value()) return RPCResult("Error: Invalid time format.", RPCResult::Status::BAD_INPUT);
+        const auto interval = std::visit([](auto&& time) { return k_time_ms(time); }, time_variant.value());
+        if (interval < _cfg.min_publish_interval) {
+            return RPCResult("Error: Interval is too short.", RPCResult::Status::BAD_INPUT);
+        }
+
+        uint32_t columns = all_columns;
+        if (separator != std::string_view::npos) {
+            columns = 0;
+            auto names = args->substr(separator + prompt::Dialect::VALUE_SEPARATOR.size());
+            while (!names.empty()) {
+                const auto next = names.find(prompt::Dialect::VALUE_SEPARATOR);
+                const auto name = names.substr(0, next);
+                const auto column = std::find_if(_cfg.active_dataproviders.begin(), _cfg.active_dataproviders.end(),
+                                                 [&](DataProviders p) { return magic_enum::enum_name(p) == name; });
+                if (column == _cfg.active_dataproviders.end()) {
+                    return RPCResult("Error: Unknown column " + std::string(name), RPCResult::Status::BAD_INPUT);
                 }
-                len += i.size();
-            };
-
-            std::array<char, 32> buffer{};
-            for (auto it = _cfg.active_dataproviders.begin(); it != _cfg.active_dataproviders.end(); ++it) {
-                const auto value = _hws.analog_sensor(meta::ENUM_IDX(*it)).value();
-                int written = std::snprintf(buffer.data(), buffer.size(), "%.3f", (double)value);
-                spn_expect(written > 0 && written < buffer.size());
-                if (written > 0 && written < buffer.size()) put(std::string_view(buffer.data(), written));
-                if (std::next(it) != _cfg.active_dataproviders.end()) put(prompt::Dialect::VALUE_SEPARATOR);
+                columns |= uint32_t(1) << std::distance(_cfg.active_dataproviders.begin(), column);
+                names = next == std::string_view::npos
+                            ? std::string_view()
+                            : names.substr(next + prompt::Dialect::VALUE_SEPARATOR.size());
             }
-            return len;
-        };
-
-        // First pass to calculate total length
-        size_t reserved_length = timeseries_repr(nullptr, true);
+            if (columns == 0) return RPCResult("Error: No columns selected.", RPCResult::Status::BAD_INPUT);
+        }
 
-        // Reserve capacity to avoid multiple allocations
-        std::string timeseries{};
-        timeseries.reserve(reserved_length);
-        reserved_length = timeseries.capacity(); // for sanity checks below
+        _subscription = Subscription{.active = true,
+                                     .generation = _subscription.generation + 1,
+                                     .interval = interval,
+                                     .columns = columns};
+        LOG("DAQ: Publishing a row every %lims", interval.raw());
+        evsys()->schedule(evsys()->event(Events::DAQPublish, interval,
+                                         Event::Data(static_cast<double>(_subscription.generation))));
+        return RPCResult(datasources_as_string(columns));
+    }
 
-        // Second pass to build the string
-        timeseries_repr(&timeseries, false);
+    /// Cancels the running subscription, if any
+    prompt::RPCResult unsubscribe() {
+        _subscription.active = false;
+        return prompt::RPCResult(std::to_string(_subscription.published) + std::string(prompt::Dialect::VALUE_SEPARATOR)
+                                 + std::to_string(_subscription.dropped));
+    }
 
-        spn_assert(timeseries.size() <= reserved_length); // no reallocation
-        spn_assert(timeseries.capacity() == reserved_length); // no reallocation
+    /// Publishes a row to the subscriber. When the outgoing buffer is full the row is dropped instead of waiting.
+    void publish_row() {
+        spn_assert(_prompt);
+        size_t column_count = 0;
+        for (size_t column = 0; column < _cfg.active_dataproviders.size(); ++column)
+            column_count += is_selected(_subscription.columns, column);
 
-        return timeseries;
+        const auto max_row_size = column_count * (max_value_size + prompt::Dialect::VALUE_SEPARATOR.size());
+        const auto is_published = _prompt->publish(
+            rpc_module, _subscription.sequence++, max_row_size,
+            [this](prompt::ReplyWriter& reply) { write_timeseries(reply, _subscription.columns); });
+        if (is_published) {
+            ++_subscription.published;
+        } else {
+            ++_subscription.dropped;
+            DBG("DAQ: Dropped row %li", static_cast<long>(_subscription.sequence - 1));
+        }
     }
 
-private:
+    /// A subscription to rows published periodically, tagged with a sequence number
+    struct Subscription {
+        bool active = false;
+        uint32_t generation = 0; // tells the events of a cancelled subscription apart from those of its successor
+        k_time_ms interval = k_time_ms(0);
+        uint32_t columns = all_columns; // bitmask over the active dataproviders
+        uint32_t sequence = 0;
+        uint32_t published = 0;
+        uint32_t dropped = 0;
+    };
+
+    static constexpr std::string_view rpc_module = "DAQ";
+
     const Config _cfg;
     Status _status;
+
+    std::shared_ptr<Prompt> _prompt;
+    Subscription _subscription;
 };
 } // namespace kaskas::component
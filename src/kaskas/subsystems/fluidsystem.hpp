@@ -15,6 +15,8 @@
 #include <spine/structure/time/timers.hpp>
 
 #include <cstdint>
+#include <optional>
+#include <string_view>
 
 namespace kaskas::component {
 
@@ -82,6 +84,7 @@ public:
     }
 
     void handle_event(const Event& event) override {
+        const auto allocations = allocation_scope(event);
         switch (static_cast<Events>(event.id())) {
         case Events::OutOfWater: {
             LOG("Fluidsystem: Events::OutOfWater: Pump reports it is out of water");
@@ -193,30 +196,30 @@ public:
         auto model = std::make_unique<RPCRecipe>(RPCRecipe(
             _cfg.name,
             {
-                RPCModel("timeSinceLastDosis",
-                         [this](const OptStringView& unit_of_time) {
-                             if (unit_of_time->compare("m") == 0)
-                                 return RPCResult(std::to_string(k_time_m(_pump.time_since_last_injection()).raw()));
-                             if (unit_of_time->compare("h") == 0)
-                                 return RPCResult(std::to_string(k_time_h(_pump.time_since_last_injection()).raw()));
-                             return RPCResult(std::to_string(k_time_s(_pump.time_since_last_injection()).raw()));
-                         }),
+                RPCModel::typed("timeSinceLastDosis",
+                                [this](std::optional<std::string_view> unit_of_time) {
+                                    if (unit_of_time == "m")
+                                        return RPCResult(
+                                            std::to_string(k_time_m(_pump.time_since_last_injection()).raw()));
+                                    if (unit_of_time == "h")
+                                        return RPCResult(
+                                            std::to_string(k_time_h(_pump.time_since_last_injection()).raw()));
+                                    return RPCResult(std::to_string(k_time_s(_pump.time_since_last_injection()).raw()));
+                                }),
                 RPCModel("isOutOfWater",
                          [this](const OptStringView&) {
                              return RPCResult(this->_pump.is_out_of_fluid() ? "True" : "False"); // Pythonic boolean
                          }),
-                RPCModel("waterNow",
-                         [this](const OptStringView& amount_in_ml) {
-                             if (!amount_in_ml)
-                                 return RPCResult("cannot inject: amount to inject (in ml) not specified",
-                                                  RPCResult::Status::BAD_INPUT);
-                             if (_status.Flags.injection_needs_evaluation)
-                                 return RPCResult("cannot inject: last injection was not evaluated",
-                                                  RPCResult::Status::BAD_RESULT);
-                             evsys()->schedule(Events::WaterInjectStart, k_time_s(1),
-                                               Event::Data(spn::core::utils::to_float(amount_in_ml.value())));
-                             return RPCResult(RPCResult::Status::OK);
-                         }),
+                RPCModel::typed(
+                    "waterNow",
+                    [this](float amount_in_ml) {
+                        if (_status.Flags.injection_needs_evaluation)
+                            return RPCResult("cannot inject: last injection was not evaluated",
+                                             RPCResult::Status::BAD_RESULT);
+                        evsys()->schedule(Events::WaterInjectStart, k_time_s(1), Event::Data(amount_in_ml));
+                        return RPCResult(RPCResult::Status::OK);
+                    },
+                    "Args: amount to inject in ml"),
                 RPCModel("resetEvaluationLock",
                          [this](const OptStringView& amount_in_ml) {
                              _status.Flags.injection_needs_evaluation = false;
@@ -227,14 +230,15 @@ public:
                     [this](const OptStringView& _) {
                         return RPCResult(std::to_string(_ml_per_percent_of_moisture.value()));
                     },
-                    "tracks amount of moisture raised per mL of fluid dosed"),
+                    "tracks amount of moisture raised per mL of fluid dosed",
+                    RPCModel::CachePolicy::time_to_live(k_time_s(60))), // evaluated hours apart
                 RPCModel(
                     "calibrationDosis",
                     [this](const OptStringView& _) { return RPCResult(std::to_string(_cfg.calibration_dosis_ml)); },
-                    "The calibration dosage used when no fluid effect is known"),
+                    "The calibration dosage used when no fluid effect is known", RPCModel::CachePolicy::constant()),
                 RPCModel(
                     "maxDosis", [this](const OptStringView& _) { return RPCResult(std::to_string(_cfg.max_dosis_ml)); },
-                    "The maximum allowed dosage."),
+                    "The maximum allowed dosage.", RPCModel::CachePolicy::constant()),
             }));
         return std::move(model);
     }
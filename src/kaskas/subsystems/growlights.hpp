@@ -14,6 +14,7 @@
 #include <spine/structure/time/timers.hpp>
 
 #include <cstdint>
+#include <optional>
 
 namespace kaskas::component {
 
@@ -66,6 +67,7 @@ public:
     }
 
     void handle_event(const Event& event) override {
+        const auto allocations = allocation_scope(event);
         const auto now_s = [&]() {
             if (!_clock.is_ready()) {
                 spn::throw_exception(
@@ -148,66 +150,32 @@ public:
         auto model = std::make_unique<RPCRecipe>(
             RPCRecipe("Growlights", //
                       {
-                          RPCModel(
+                          RPCModel::typed(
                               "turnOnBroadSpectrumLights",
-                              [this](const OptStringView& unit_of_time) {
-                                  if (!unit_of_time.has_value()) {
-                                      evsys()->trigger(Events::LightBroadSpectrumTurnOn);
-                                      return RPCResult(RPCResult::Status::OK);
-                                  }
-
-                                  auto time_variant = spn::core::utils::parse_time(unit_of_time.value());
-                                  if (!time_variant.has_value()) {
-                                      return RPCResult("Error: Invalid time format.");
-                                  }
-
-                                  std::visit(
-                                      [this](auto&& time) {
-                                          evsys()->trigger(Events::LightBroadSpectrumTurnOn);
-                                          evsys()->schedule(Events::LightBroadSpectrumTurnOff, time);
-                                      },
-                                      time_variant.value());
+                              [this](std::optional<k_time_ms> duration) {
+                                  evsys()->trigger(Events::LightBroadSpectrumTurnOn);
+                                  if (duration) evsys()->schedule(Events::LightBroadSpectrumTurnOff, *duration);
                                   return RPCResult(RPCResult::Status::OK);
                               },
                               "Args: length and unit of time, eg. 10s or 1d"),
-                          RPCModel(
+                          RPCModel::typed(
                               "turnOnVioletSpectrumLights",
-                              [this](const OptStringView& unit_of_time) {
-                                  if (!unit_of_time.has_value()) {
-                                      evsys()->trigger(Events::LightVioletSpectrumTurnOn);
-                                      return RPCResult(RPCResult::Status::OK);
-                                  }
-
-                                  auto time_variant = spn::core::utils::parse_time(unit_of_time.value());
-                                  if (!time_variant.has_value()) {
-                                      return RPCResult("Error: Invalid time format.");
-                                  }
-
-                                  std::visit(
-                                      [this](auto&& time) {
-                                          evsys()->trigger(Events::LightVioletSpectrumTurnOn);
-                                          evsys()->schedule(Events::LightVioletSpectrumTurnOff, time);
-                                      },
-                                      time_variant.value());
+                              [this](std::optional<k_time_ms> duration) {
+                                  evsys()->trigger(Events::LightVioletSpectrumTurnOn);
+                                  if (duration) evsys()->schedule(Events::LightVioletSpectrumTurnOff, *duration);
                                   return RPCResult(RPCResult::Status::OK);
                               },
                               "Args: length and unit of time, eg. 10s or 1d"),
-                          RPCModel("turnOffBroadSpectrumLights",
-                                   [this](const OptStringView& unit_of_time) {
-                                       if (!unit_of_time.has_value()) {
-                                           evsys()->trigger(Events::LightBroadSpectrumTurnOff);
-                                           return RPCResult(RPCResult::Status::OK);
-                                       }
-                                       return RPCResult("no arguments accepted", RPCResult::Status::BAD_INPUT);
-                                   }),
-                          RPCModel("turnOffVioletSpectrumLights",
-                                   [this](const OptStringView& unit_of_time) {
-                                       if (!unit_of_time.has_value()) {
-                                           evsys()->trigger(Events::LightVioletSpectrumTurnOff);
-                                           return RPCResult(RPCResult::Status::OK);
-                                       }
-                                       return RPCResult("no arguments accepted", RPCResult::Status::BAD_INPUT);
-                                   }),
+                          RPCModel::typed("turnOffBroadSpectrumLights",
+                                          [this]() {
+                                              evsys()->trigger(Events::LightBroadSpectrumTurnOff);
+                                              return RPCResult(RPCResult::Status::OK);
+                                          }),
+                          RPCModel::typed("turnOffVioletSpectrumLights",
+                                          [this]() {
+                                              evsys()->trigger(Events::LightVioletSpectrumTurnOff);
+                                              return RPCResult(RPCResult::Status::OK);
+                                          }),
                       }));
         return std::move(model);
     }
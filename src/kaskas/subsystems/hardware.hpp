@@ -6,6 +6,9 @@
 #include <spine/core/exception.hpp>
 #include <spine/eventsystem/eventsystem.hpp>
 
+#include <algorithm>
+#include <cstdio>
+
 namespace kaskas::component {
 
 using spn::core::Event;
@@ -33,6 +36,7 @@ public:
     }
 
     void handle_event(const Event& event) override {
+        const auto allocations = allocation_scope(event);
         switch (static_cast<Events>(event.id())) {
         case Events::SensorFollowUp:
             _hws.update_all();
@@ -55,13 +59,60 @@ public:
                                    [this](const OptStringView& _) {
                                        evsys()->schedule(evsys()->event(Events::ShutDown, k_time_s(1)));
                                        return RPCResult(RPCResult::Status::OK);
-                                   }),
+                                   },
+                                   "", RPCModel::CachePolicy::none(), RPCModel::Priority::SAFETY),
+                          RPCModel(
+                              "allocStats",
+                              [](const OptStringView& arg, ReplyWriter& reply) { write_allocation_stats(arg, reply); },
+                              "Args: optionally 'reset'. Replies with allocations|deallocations|bytes in total, "
+                              "followed by a label|allocations|deallocations|bytes record per RPC, event or "
+                              "peripheral, records separated by ',' (native builds only)",
+                              RPCModel::CachePolicy::none(), RPCModel::Priority::BULK),
                       }));
         return std::move(model);
     }
     void sideload_providers(io::VirtualStackFactory& ssf) override {}
 
 private:
+    /// Writes the heap allocation statistics, a record per scope separated by `RECORD_SEPARATOR`, or resets them. The
+    /// records share the reply's line, as a line ends the reply.
+    static void write_allocation_stats(const prompt::OptStringView& arg, prompt::ReplyWriter& reply) {
+        using core::AllocationTracker;
+        using prompt::RPCResult;
+        if (!AllocationTracker::is_enabled) {
+            reply.set_status(RPCResult::Status::BAD_RESULT);
+            reply.write("Allocations are only tracked on native builds");
+            return;
+        }
+        if (arg) {
+            if (*arg != "reset") {
+                reply.set_status(RPCResult::Status::BAD_INPUT);
+                return;
+            }
+            AllocationTracker::reset();
+            return;
+        }
+
+        write_stats(reply, AllocationTracker::total());
+        reply.stream([scope = size_t(0)](prompt::ReplyWriter& reply) mutable {
+            if (scope >= AllocationTracker::scope_count()) return false;
+            const auto& s = AllocationTracker::scope(scope++);
+            reply.write(prompt::Dialect::RECORD_SEPARATOR);
+            reply.write(s.label());
+            reply.write(prompt::Dialect::VALUE_SEPARATOR);
+            write_stats(reply, s.stats);
+            return true;
+        });
+    }
+
+    static void write_stats(prompt::ReplyWriter& reply, const core::AllocationStats& stats) {
+        char text[48];
+        const int size = std::snprintf(text, sizeof(text), "%lu|%lu|%lu", static_cast<unsigned long>(stats.allocations),
+                                       static_cast<unsigned long>(stats.deallocations),
+                                       static_cast<unsigned long>(stats.bytes));
+        reply.write(std::string_view(text, size > 0 ? std::min<size_t>(size, sizeof(text) - 1) : 0));
+    }
+
     const Config _cfg;
 };
 
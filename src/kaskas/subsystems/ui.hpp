@@ -18,7 +18,7 @@ public:
         Signaltower::Config signaltower_cfg;
         DigitalInput::Config userbutton_cfg;
         k_time_ms watchdog_interval = k_time_s(1);
-        k_time_ms prompt_interval = k_time_ms(50);
+        k_time_ms prompt_interval = k_time_ms(50); // interval of prompt updates for as long as the prompt is busy
     };
 
 public:
@@ -43,11 +43,17 @@ public:
         evsys()->attach(Events::UIButtonCheck, this);
         evsys()->attach(Events::UIWatchDog, this);
         evsys()->attach(Events::UIPromptFollowUp, this);
+        evsys()->attach(Events::UIPromptLineReady, this);
         evsys()->attach(Events::OutOfWater, this);
 
         evsys()->schedule(evsys()->event(Events::UIButtonCheck, k_time_s(1)));
         evsys()->schedule(evsys()->event(Events::UIWatchDog, _cfg.watchdog_interval));
-        evsys()->schedule(evsys()->event(Events::UIPromptFollowUp, k_time_s(1)));
+        if (_prompt) {
+            // the prompt is updated when a line arrives, and followed up on only while it is busy
+            _prompt->set_publish_listener([this]() { follow_up_prompt(); });
+            _is_prompt_follow_up_scheduled = true;
+            evsys()->schedule(evsys()->event(Events::UIPromptFollowUp, k_time_s(1)));
+        }
 
         DBG("UI: Initialized. Prompt interval: %lims", k_time_ms(_cfg.prompt_interval).raw())
     }
@@ -67,6 +73,7 @@ public:
     }
 
     void handle_event(const Event& event) override {
+        const auto allocations = allocation_scope(event);
         switch (static_cast<Events>(event.id())) {
         case Events::WakeUp: {
             DBG("UI: WakeUp");
@@ -91,9 +98,13 @@ public:
             break;
         }
         case Events::UIPromptFollowUp: {
+            _is_prompt_follow_up_scheduled = false;
+            [[fallthrough]];
+        }
+        case Events::UIPromptLineReady: {
             spn_assert(_prompt);
             _prompt->update();
-            evsys()->schedule(Events::UIPromptFollowUp, _cfg.prompt_interval);
+            if (!_prompt->is_idle()) follow_up_prompt();
             break;
         }
         case Events::OutOfWater: {
@@ -113,6 +124,12 @@ public:
 private:
     using LogicalState = spn::core::LogicalState;
 
+    void follow_up_prompt() {
+        if (_is_prompt_follow_up_scheduled) return;
+        _is_prompt_follow_up_scheduled = true;
+        evsys()->schedule(Events::UIPromptFollowUp, _cfg.prompt_interval);
+    }
+
     const Config _cfg;
 
     Signaltower _signaltower;
@@ -120,6 +137,7 @@ private:
     DigitalInput _userbutton;
 
     std::shared_ptr<Prompt> _prompt;
+    bool _is_prompt_follow_up_scheduled = false;
 
 #if defined(STM32F429xx)
     DigitalOutput _builtin_led_blue = DigitalOutput::Config{.pin = PB7, .active_on_low = false};
@@ -2,6 +2,8 @@
 
 #    include "kaskas/io/hardware_stack.hpp"
 #    include "kaskas/io/peripherals/DS18B20_Temp_Probe.hpp"
+#    include "kaskas/io/peripherals/DS3231_RTC_EEPROM.hpp"
+#    include "kaskas/io/peripherals/SHT31_TempHumidityProbe.hpp"
 #    include "kaskas/io/peripherals/analogue_input.hpp"
 #    include "kaskas/io/peripherals/analogue_output.hpp"
 #    include "kaskas/kaskas.hpp"
@@ -267,6 +269,7 @@ void setup() {
                         .check_interval = heating_sample_interval}};
 
         auto ventilation = std::make_unique<ClimateControl>(*hws, cc_cfg);
+        ventilation->hotload_prompt(kk->prompt());
         kk->hotload_component(std::move(ventilation));
     }
 
@@ -377,6 +380,7 @@ void setup() {
         auto cfg = DataAcquisition::Config{.initial_warm_up_time = k_time_s(30), .active_dataproviders = datasources};
 
         auto ctrl = std::make_unique<DataAcquisition>(*hws, cfg);
+        ctrl->hotload_prompt(kk->prompt());
         kk->hotload_component(std::move(ctrl));
     }
     kk->initialize();
@@ -0,0 +1,417 @@
+#include "kaskas/core/allocation_tracker.hpp"
+#include "kaskas/data_providers.hpp"
+#include "kaskas/prompt/prompt.hpp"
+#include "kaskas/prompt/rpc/index.hpp"
+#include "kaskas/prompt/rpc/rpc.hpp"
+
+#include <magic_enum/magic_enum.hpp>
+#include <spine/io/stream/implementations/mock.hpp>
+#include <spine/platform/hal.hpp>
+#include <unity.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace kaskas::prompt;
+using DataProviders = ::DataProviders;
+using spn::io::BufferedStream;
+using spn::io::MockStream;
+
+using kaskas::core::AllocationTracker;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+/// Prevent the optimizer from throwing away benchmarked lookups
+volatile uintptr_t g_sink = 0;
+
+constexpr size_t g_models_per_recipe = 8;
+constexpr size_t g_lookup_rounds = 200;
+
+/// Builds `model_count` models spread over recipes of `g_models_per_recipe` models each.
+RPCIndex::Recipes make_recipes(size_t model_count) {
+    RPCIndex::Recipes recipes;
+    for (size_t r = 0; r * g_models_per_recipe < model_count; ++r) {
+        auto rf = RPCRecipeFactory("MOD" + std::to_string(r));
+        for (size_t m = 0; m < g_models_per_recipe && r * g_models_per_recipe + m < model_count; ++m) {
+            rf.add_model(RPCModel("command" + std::to_string(m),
+                                  [](const OptStringView&) { return RPCResult(RPCResult::Status::OK); }));
+        }
+        recipes.emplace_back(rf.extract_recipe());
+    }
+    return recipes;
+}
+
+/// The lookup as done before the dispatch index: a linear scan over recipes followed by a linear scan over models
+const RPCModel* linear_lookup(const RPCIndex::Recipes& recipes, const std::string_view& module,
+                              const std::string_view& command) {
+    for (const auto& recipe : recipes) {
+        if (recipe->module() == module) {
+            const auto model = recipe->find_model_for_command(command);
+            return model ? *model : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+template<typename F>
+double ns_per_lookup(const std::vector<Message>& queries, F&& lookup) {
+    const auto start = Clock::now();
+    for (size_t round = 0; round < g_lookup_rounds; ++round) {
+        for (const auto& q : queries) {
+            g_sink = g_sink + reinterpret_cast<uintptr_t>(lookup(q));
+        }
+    }
+    const auto elapsed = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    return elapsed / static_cast<double>(g_lookup_rounds * queries.size());
+}
+
+/// Results are reported as a line of JSON each. When `KASKAS_BENCHMARK_OUTPUT` names a file, the lines are appended
+/// to it as well, so that runs against different versions of KasKas and Spine can be compared.
+void report(const char* json) {
+    TEST_MESSAGE(json);
+    if (const auto path = std::getenv("KASKAS_BENCHMARK_OUTPUT")) {
+        if (auto file = std::fopen(path, "a")) {
+            std::fprintf(file, "%s\n", json);
+            std::fclose(file);
+        }
+    }
+}
+
+constexpr size_t g_io_buffer_size = 1024; // as configured in main.cpp
+constexpr size_t g_round_trips = 500;
+
+/// The prompt on top of a `MockStream`, loaded with recipes resembling those of a complete KasKas: a provider per
+/// `DataProviders` entry and a `DAQ` module replying with a value per provider.
+struct PromptBench {
+    PromptBench()
+        : ms(std::make_shared<MockStream>(
+              MockStream::Config{.input_buffer_size = g_io_buffer_size, .output_buffer_size = g_io_buffer_size})),
+          prompt(Prompt::Config{.io_buffer_size = g_io_buffer_size,
+                                .line_delimiters = "\r\n",
+                                .rate_limit_per_s = 0}) { // measure the requests, not their rejection
+        ms->initialize();
+        prompt.add_datalink(std::make_shared<Datalink>(ms, Datalink::Config{.input_buffer_size = g_io_buffer_size,
+                                                                            .output_buffer_size = g_io_buffer_size,
+                                                                            .delimiters = "\r\n"}));
+        for (size_t i = 0; i < magic_enum::enum_count<DataProviders>() - 1; ++i) {
+            const auto provider = static_cast<DataProviders>(i);
+            prompt.hotload_rpc_recipe(std::make_unique<RPCRecipe>(RPCRecipe(
+                magic_enum::enum_name(provider),
+                {RPCModel("value", [i](const OptStringView&) { return RPCResult(std::to_string(value_of(i))); })})));
+        }
+        prompt.hotload_rpc_recipe(std::make_unique<RPCRecipe>(RPCRecipe(
+            "DAQ", {
+                       RPCModel("getTimeSeries",
+                                [](const OptStringView&, ReplyWriter& reply) {
+                                    reply.stream([column = size_t(0)](ReplyWriter& reply) mutable {
+                                        if (column > 0) reply.write(Dialect::VALUE_SEPARATOR);
+                                        reply.write(value_of(column), 3);
+                                        return ++column < magic_enum::enum_count<DataProviders>() - 1;
+                                    });
+                                }),
+                       RPCModel("setInterval",
+                                [](const OptStringView& s) { return RPCResult(std::string(s ? *s : "none")); }),
+                   })));
+        prompt.initialize();
+    }
+
+    static float value_of(size_t provider) { return 20.0f + 0.125f * static_cast<float>(provider); }
+
+    /// Sends a single request and waits for its reply line. Returns the size of the reply.
+    size_t round_trip(const std::string& request) {
+        ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+        size_t reply_size = 0;
+        for (bool is_complete = false; !is_complete;) {
+            const auto allocations = AllocationTracker::total().allocations;
+            const auto start = Clock::now();
+            prompt.update();
+            elapsed += Clock::now() - start;
+            update_allocations += AllocationTracker::total().allocations - allocations;
+
+            const auto reply = ms->extract_bytestream();
+            if (!reply) continue;
+            reply_size += reply->size();
+            is_complete = reply->size() >= 2 && reply->back() == '\n';
+        }
+        return reply_size;
+    }
+
+    std::shared_ptr<MockStream> ms;
+    Prompt prompt;
+
+    Clock::duration elapsed = Clock::duration(0); // time spent in `update()`
+    size_t update_allocations = 0; // heap allocations made from within `update()`
+};
+
+double percentile(std::vector<double>& samples, double p) {
+    std::sort(samples.begin(), samples.end());
+    return samples[std::min(samples.size() - 1, static_cast<size_t>(p * static_cast<double>(samples.size())))];
+}
+
+} // namespace
+
+void setUp(void) {}
+void tearDown(void) {}
+
+void bm_rpc_dispatch_linear_vs_index() {
+    for (const size_t model_count : {32, 128, 512}) {
+        const auto recipes = make_recipes(model_count);
+
+        auto index = RPCIndex();
+        index.build(recipes);
+        TEST_ASSERT_EQUAL(model_count, index.model_count());
+
+        std::vector<Message> queries;
+        for (const auto& r : recipes) {
+            for (const auto& m : r->models()) {
+                queries.emplace_back(r->module(), Dialect::OPERANT_REQUEST, m.name());
+            }
+        }
+
+        // sanity: both lookups must agree on every query
+        for (const auto& q : queries) {
+            TEST_ASSERT(linear_lookup(recipes, q.module, q.cmd_or_status) == index.model(q.module, q.cmd_or_status));
+        }
+
+        const auto linear_ns =
+            ns_per_lookup(queries, [&](const Message& q) { return linear_lookup(recipes, q.module, q.cmd_or_status); });
+        const auto index_ns =
+            ns_per_lookup(queries, [&](const Message& q) { return index.model(q.module, q.cmd_or_status); });
+
+        char json[160];
+        std::snprintf(json, sizeof(json),
+                      "{\"benchmark\":\"rpc_dispatch\",\"models\":%zu,\"linear_ns\":%.1f,\"index_ns\":%.1f}",
+                      model_count, linear_ns, index_ns);
+        report(json);
+    }
+}
+
+/// Round trips of single requests through `MockStream`, `Datalink`, `Prompt` and `RPCFactory`. Latency is the time
+/// spent in `Prompt::update()` until the reply is complete, excluding the mock stream's own bookkeeping.
+void bm_prompt_request_latency() {
+    for (const auto request : {"CLIMATE_TEMP:value\n", "DAQ:setInterval:1000\n", "DAQ:getTimeSeries\n", "?\n"}) {
+        auto bench = PromptBench();
+        bench.round_trip(request); // warm up
+
+        std::vector<double> latencies_us;
+        latencies_us.reserve(g_round_trips);
+        size_t reply_bytes = 0;
+        bench.elapsed = Clock::duration(0);
+        bench.update_allocations = 0;
+        for (size_t i = 0; i < g_round_trips; ++i) {
+            const auto before = bench.elapsed;
+            reply_bytes += bench.round_trip(request);
+            latencies_us.push_back(std::chrono::duration<double, std::micro>(bench.elapsed - before).count());
+        }
+        TEST_ASSERT(reply_bytes > g_round_trips);
+
+        const auto total_s = std::chrono::duration<double>(bench.elapsed).count();
+        const auto name = std::string(request, std::strlen(request) - 1);
+        char json[320];
+        std::snprintf(json, sizeof(json),
+                      "{\"benchmark\":\"prompt_request\",\"api\":\"%s\",\"request\":\"%s\",\"messages\":%zu,"
+                      "\"messages_per_s\":%.0f,\"p50_us\":%.2f,\"p99_us\":%.2f,\"bytes_per_reply\":%.1f,"
+                      "\"allocations_per_message\":%.2f}",
+                      std::string(Dialect::API_VERSION).c_str(), name.c_str(), g_round_trips,
+                      static_cast<double>(g_round_trips) / total_s, percentile(latencies_us, 0.50),
+                      percentile(latencies_us, 0.99), static_cast<double>(reply_bytes) / g_round_trips,
+                      static_cast<double>(bench.update_allocations) / g_round_trips);
+        report(json);
+    }
+}
+
+/// A burst of requests sent at once and handled over as many updates as the prompt's budgets require.
+void bm_prompt_pipelined_throughput() {
+    constexpr size_t burst_size = 32;
+    constexpr size_t bursts = 50;
+    const auto requests = std::vector<std::string>{"CLIMATE_TEMP:value", "SOIL_MOISTURE:value", "DAQ:setInterval:1000",
+                                                   "PUMP:value"};
+
+    std::string burst;
+    for (size_t i = 0; i < burst_size; ++i)
+        burst += requests[i % requests.size()] + "\n";
+    TEST_ASSERT(burst.size() <= g_io_buffer_size);
+
+    auto bench = PromptBench();
+    size_t reply_bytes = 0;
+    size_t replies = 0;
+    const auto allocations = AllocationTracker::total().allocations;
+    const auto start = Clock::now();
+    for (size_t b = 0; b < bursts; ++b) {
+        bench.ms->inject_bytestream(std::vector<uint8_t>(burst.begin(), burst.end()));
+        for (size_t received = 0; received < burst_size;) {
+            bench.prompt.update();
+            const auto reply = bench.ms->extract_bytestream();
+            if (!reply) continue;
+            reply_bytes += reply->size();
+            received += std::count(reply->begin(), reply->end(), '\n');
+        }
+        replies += burst_size;
+    }
+    const auto total_s = std::chrono::duration<double>(Clock::now() - start).count();
+
+    char json[256];
+    std::snprintf(json, sizeof(json),
+                  "{\"benchmark\":\"prompt_pipelined\",\"api\":\"%s\",\"burst\":%zu,\"messages\":%zu,"
+                  "\"messages_per_s\":%.0f,\"bytes_per_reply\":%.1f,\"allocations_per_message\":%.2f}",
+                  std::string(Dialect::API_VERSION).c_str(), burst_size, replies,
+                  static_cast<double>(replies) / total_s, static_cast<double>(reply_bytes) / replies,
+                  static_cast<double>(AllocationTracker::total().allocations - allocations) / replies);
+    report(json);
+}
+
+/// Tokenizes a corpus of requests, as found on a KasKas' serial line, malformed ones included.
+void bm_message_parser() {
+    const auto corpus = std::vector<std::string>{"CLIMATE_TEMP:value",
+                                                 "DAQ:setInterval:1000",
+                                                 "DAQ:getTimeSeries",
+                                                 "HW:allocStats:reset",
+                                                 "CLIMATE_HUMIDITY_SETPOINT:value:62.5|12|1",
+                                                 "?",
+                                                 ":value",
+                                                 "DAQ:",
+                                                 "NO_OPERANT_AT_ALL"};
+    size_t bytes = 0;
+    for (const auto& request : corpus)
+        bytes += request.size();
+
+    constexpr size_t rounds = 20000;
+    size_t valid = 0;
+    const auto start = Clock::now();
+    for (size_t round = 0; round < rounds; ++round) {
+        for (const auto& request : corpus) {
+            const auto message = IncomingMessageFactory::from_view(request);
+            if (message) {
+                ++valid;
+                g_sink = g_sink + message->cmd_or_status.size();
+            }
+        }
+    }
+    const auto elapsed_ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    TEST_ASSERT_EQUAL(rounds * 6, valid);
+
+    char json[192];
+    std::snprintf(json, sizeof(json),
+                  "{\"benchmark\":\"message_parser\",\"api\":\"%s\",\"requests\":%zu,\"ns_per_request\":%.1f,"
+                  "\"mb_per_s\":%.1f}",
+                  std::string(Dialect::API_VERSION).c_str(), corpus.size(),
+                  elapsed_ns / static_cast<double>(rounds * corpus.size()),
+                  static_cast<double>(rounds * bytes) / elapsed_ns * 1e3);
+    report(json);
+}
+
+/// The bulk replies, plain and compressed. Reports the bytes and the time spent in `Prompt::update()` per reply, and
+/// the time the reply takes on a 115200 baud line.
+void bm_reply_compression() {
+    constexpr size_t replies = 100;
+    constexpr double line_bytes_per_s = 115200 / 10.0; // 8N1
+    for (const auto request : {"DAQ:getTimeSeries\n", "?\n"}) {
+        double bytes_per_reply[2] = {};
+        double us_per_reply[2] = {};
+        for (const auto is_compressed : {false, true}) {
+            auto bench = PromptBench();
+            if (is_compressed) bench.round_trip("Prompt:compress:1\n");
+            bench.round_trip(request); // warm up
+
+            size_t reply_bytes = 0;
+            bench.elapsed = Clock::duration(0);
+            for (size_t i = 0; i < replies; ++i)
+                reply_bytes += bench.round_trip(request);
+            bytes_per_reply[is_compressed] = static_cast<double>(reply_bytes) / replies;
+            us_per_reply[is_compressed] = std::chrono::duration<double, std::micro>(bench.elapsed).count() / replies;
+        }
+        TEST_ASSERT(bytes_per_reply[1] < bytes_per_reply[0]);
+
+        const auto name = std::string(request, std::strlen(request) - 1);
+        char json[384];
+        std::snprintf(json, sizeof(json),
+                      "{\"benchmark\":\"reply_compression\",\"api\":\"%s\",\"request\":\"%s\","
+                      "\"plain_bytes\":%.0f,\"compressed_bytes\":%.0f,\"ratio\":%.2f,\"plain_update_us\":%.1f,"
+                      "\"compressed_update_us\":%.1f,\"plain_line_ms\":%.1f,\"compressed_line_ms\":%.1f}",
+                      std::string(Dialect::API_VERSION).c_str(), name.c_str(), bytes_per_reply[0], bytes_per_reply[1],
+                      bytes_per_reply[0] / bytes_per_reply[1], us_per_reply[0], us_per_reply[1],
+                      1e3 * bytes_per_reply[0] / line_bytes_per_s, 1e3 * bytes_per_reply[1] / line_bytes_per_s);
+        report(json);
+    }
+}
+
+/// Feeds a line that fills the buffer to `ms` a byte at a time, calling `poll` after every byte, which returns true
+/// once it has read the line. Returns the time spent per byte in nanoseconds.
+template<typename Poll>
+double dribble_line(MockStream& ms, size_t line_size, size_t rounds, Poll&& poll) {
+    auto elapsed_ns = 0.0;
+    for (size_t round = 0; round < rounds; ++round) {
+        size_t lines = 0;
+        const auto start = Clock::now();
+        for (size_t i = 0; i <= line_size; ++i) {
+            ms.inject_bytestream({static_cast<uint8_t>(i < line_size ? 'a' + i % 26 : '\n')});
+            lines += poll();
+        }
+        elapsed_ns += std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+        TEST_ASSERT_EQUAL(1, lines);
+    }
+    return elapsed_ns / static_cast<double>(rounds * (line_size + 1));
+}
+
+/// A slow sender dribbling a line into a 1 KB buffer, a byte per poll. Compares asking the buffered stream for a line
+/// on every poll, which rescans the buffer each time, with the datalink, which scans every byte once.
+void bm_dribbled_line() {
+    constexpr size_t line_size = g_io_buffer_size - 1; // the line and its delimiter fill the buffer
+    constexpr size_t rounds = 20;
+    const auto cfg = BufferedStream::Config{
+        .input_buffer_size = g_io_buffer_size, .output_buffer_size = g_io_buffer_size, .delimiters = "\r\n"};
+    const auto make_stream = []() {
+        auto ms = std::make_shared<MockStream>(
+            MockStream::Config{.input_buffer_size = g_io_buffer_size, .output_buffer_size = g_io_buffer_size});
+        ms->initialize();
+        return ms;
+    };
+
+    const auto rescan_ms = make_stream();
+    BufferedStream rescan(rescan_ms, BufferedStream::Config(cfg));
+    const auto rescan_ns = dribble_line(*rescan_ms, line_size, rounds, [&rescan]() {
+        rescan.pull_in_data();
+        return rescan.new_transaction().has_value();
+    });
+
+    const auto incremental_ms = make_stream();
+    Datalink incremental(incremental_ms, cfg);
+    const auto incremental_ns = dribble_line(*incremental_ms, line_size, rounds, [&incremental]() {
+        incremental.pull();
+        return incremental.read_line().has_value();
+    });
+
+    char json[192];
+    std::snprintf(json, sizeof(json),
+                  "{\"benchmark\":\"dribbled_line\",\"api\":\"%s\",\"buffer_bytes\":%zu,"
+                  "\"rescan_ns_per_byte\":%.1f,\"incremental_ns_per_byte\":%.1f}",
+                  std::string(Dialect::API_VERSION).c_str(), g_io_buffer_size, rescan_ns, incremental_ns);
+    report(json);
+}
+
+int run_all_benchmarks() {
+    UNITY_BEGIN();
+    if (!AllocationTracker::is_enabled) TEST_MESSAGE("allocations are not tracked in this build; reported as 0");
+    RUN_TEST(bm_rpc_dispatch_linear_vs_index);
+    RUN_TEST(bm_message_parser);
+    RUN_TEST(bm_prompt_request_latency);
+    RUN_TEST(bm_prompt_pipelined_throughput);
+    RUN_TEST(bm_dribbled_line);
+    RUN_TEST(bm_reply_compression);
+    return UNITY_END();
+}
+
+#if defined(ARDUINO)
+#    include <ArduinoFake.h>
+#endif
+
+int main(int argc, char** argv) {
+    run_all_benchmarks();
+    return 0;
+}
@@ -1,3 +1,7 @@
+#include "kaskas/core/allocation_tracker.hpp"
+#include "kaskas/prompt/compression.hpp"
+#include "kaskas/prompt/framing.hpp"
+#include "kaskas/prompt/interrupt_stream.hpp"
 #include "kaskas/prompt/prompt.hpp"
 #include "kaskas/prompt/rpc/rpc.hpp"
 
@@ -6,7 +10,13 @@
 #include <spine/platform/hal.hpp>
 #include <unity.h>
 
+#include <algorithm>
+#include <chrono>
 #include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+#include <thread>
 #include <vector>
 
 using namespace spn::core;
@@ -46,6 +56,8 @@ public:
 
                                        return RPCResult(std::to_string(foo(spn::core::utils::to_float(s_str))));
                                    }),
+                          RPCModel("roVariableWriter",
+                                   [this](const OptStringView&, ReplyWriter& reply) { reply.write(roVariable, 3); }),
                       }));
         return std::move(model);
     }
@@ -70,12 +82,15 @@ const auto g_pts = std::vector<ResponsePattern>{
     {"MOC:foo:1\n", "MOC<OK:1.000000", true, true},
     {"MOC:foo\n", "MOC<BAD_INPUT", true, true},
     {"MOC:foo\n", "MOC<BAD_INPUT", true, true},
+    {"MOC:roVariableWriter\n", "MOC<OK:42.000", true, true},
     {":::\n", nullptr, false, false},
     {"1::\n", "", false, false},
     {":1:\n", nullptr, false, false},
     {":::1\n", nullptr, false, false},
     {"1:1:\n", "", true, false},
     {"1:1\n", "", true, false},
+    {"7#MOC:roVariable\n", "7#MOC<OK:42.000000", true, true},
+    {"#MOC:roVariable\n", nullptr, false, false},
 };
 
 /// Mockstream is used in every test. For Mockstream's tests, see Spine.
@@ -97,7 +112,7 @@ void setUp(void) {
 
     g_dl = std::make_shared<Datalink>(g_ms, g_dl_cfg);
     g_prompt = std::make_unique<Prompt>(std::move(prompt_cfg));
-    g_prompt->hotload_datalink(g_dl);
+    g_prompt->add_datalink(g_dl);
 
     g_mc = std::make_unique<MockController>();
     g_prompt->hotload_rpc_recipe(g_mc->rpc_recipe());
@@ -162,6 +177,97 @@ void ut_prompt_test_incoming_message_factory() {
     }
 }
 
+/// The message grammar spelled out with `std::string_view::find`, as a reference for the tokenizer.
+spn::structure::Result<Message, IncomingMessageFactory::Error> reference_message(std::string_view view) {
+    using Error = IncomingMessageFactory::Error;
+    using Result = spn::structure::Result<Message, Error>;
+    auto request_id = std::optional<std::string_view>();
+    if (view.substr(0, 1) != Dialect::OPERANT_PRINT_USAGE) {
+        const auto id_end = view.find(Dialect::REQUEST_ID_SEPARATOR);
+        if (id_end < view.find(Dialect::OPERANT_REQUEST)) {
+            request_id = view.substr(0, id_end);
+            if (!Dialect::is_valid_request_id(*request_id)) return Result::failed(Error::MALFORMED_REQUEST_ID);
+            view = view.substr(id_end + 1);
+        }
+    }
+    if (view.empty()) return Result::failed(Error::EMPTY);
+    if (view.substr(0, 1) == Dialect::OPERANT_PRINT_USAGE)
+        return Message(Dialect::OPERANT_PRINT_USAGE, Dialect::OPERANT_PRINT_USAGE, {}, std::nullopt, request_id);
+    const auto operant = view.find(Dialect::OPERANT_REQUEST);
+    if (operant == std::string_view::npos) return Result::failed(Error::MALFORMED_OPERANT);
+    if (operant == 0) return Result::failed(Error::MALFORMED_MODULE);
+    const auto rest = view.substr(operant + 1);
+    const auto separator = rest.find(Dialect::KV_SEPARATOR);
+    if (separator == 0 || rest.empty()) return Result::failed(Error::MALFORMED_COMMAND);
+    if (separator == std::string_view::npos) {
+        return Message(view.substr(0, operant), view.substr(operant, 1), rest, std::nullopt, request_id);
+    }
+    return Message(view.substr(0, operant), view.substr(operant, 1), rest.substr(0, separator),
+                   rest.substr(separator + 1), request_id);
+}
+
+void ut_prompt_test_incoming_message_factory_fuzz() {
+    // the corpus is seeded from the response patterns and grows with mutations of its entries
+    auto corpus = std::vector<std::string>();
+    for (const auto& rp : g_pts)
+        corpus.emplace_back(rp.input);
+    corpus.emplace_back("");
+    corpus.emplace_back("?");
+    corpus.emplace_back("MOC:foo:1:2");
+    corpus.emplace_back("7#MOC:foo:1#2");
+
+    uint32_t state = 0x2545F491; // xorshift32, so that failures reproduce
+    const auto random = [&state](uint32_t bound) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return bound ? state % bound : 0;
+    };
+    constexpr char interesting[] = ":?<;|#\r\n\0\xff a1"; // including an embedded null byte
+
+    const auto seed_count = corpus.size();
+    for (size_t i = 0; i < 2000; ++i) {
+        auto input = corpus[random(static_cast<uint32_t>(corpus.size()))];
+        const auto position = random(static_cast<uint32_t>(input.size() + 1));
+        const auto c = random(2) ? interesting[random(sizeof(interesting) - 1)] : static_cast<char>(random(256));
+        switch (random(4)) {
+        case 0: input.insert(position, 1, c); break;
+        case 1:
+            if (position < input.size()) input[position] = c;
+            break;
+        case 2:
+            if (position < input.size()) input.erase(position, 1);
+            break;
+        default: input.resize(position); break;
+        }
+        if (corpus.size() < seed_count + 200) corpus.emplace_back(input);
+
+        const auto msg = IncomingMessageFactory::from_view(input);
+        const auto expected = reference_message(input);
+        TEST_ASSERT_EQUAL_MESSAGE(bool(expected), bool(msg), input.c_str());
+        if (!expected) {
+            TEST_ASSERT(expected.unwrap_error_value() == msg.unwrap_error_value());
+            continue;
+        }
+
+        const auto within_input = [&input](const std::string_view& token) {
+            return token.empty()
+                   || (token.data() >= input.data() && token.data() + token.size() <= input.data() + input.size());
+        };
+        TEST_ASSERT(expected->module == msg->module);
+        TEST_ASSERT(expected->operant == msg->operant);
+        TEST_ASSERT(expected->cmd_or_status == msg->cmd_or_status);
+        TEST_ASSERT(expected->arguments == msg->arguments);
+        TEST_ASSERT(expected->request_id == msg->request_id);
+
+        // the views of a request point into the input; those of a usage request into the dialect
+        if (msg->operant == Dialect::OPERANT_PRINT_USAGE) continue;
+        TEST_ASSERT(within_input(msg->module) && within_input(msg->cmd_or_status));
+        if (msg->arguments) TEST_ASSERT(within_input(*msg->arguments));
+        if (msg->request_id) TEST_ASSERT(within_input(*msg->request_id));
+    }
+}
+
 void ut_prompt_test_outgoing_message_factory() {
     const std::string module = "MOD";
     struct OutgoingResponsePattern {
@@ -216,6 +322,38 @@ void ut_prompt_test_rpc_factory() {
     }
 }
 
+void ut_prompt_test_perfect_hash_table() {
+    using Table = PerfectHashTable<size_t>;
+    auto commands = std::vector<std::string>();
+    for (size_t i = 0; i < 512; ++i)
+        commands.push_back("command" + std::to_string(i));
+    const auto entries = [&commands]() {
+        auto entries = std::vector<Table::Entry>();
+        for (size_t i = 0; i < commands.size(); ++i)
+            entries.push_back({{"MOC", commands[i]}, i});
+        return entries;
+    };
+    const auto expect_lookups = [&commands](const Table& table) {
+        for (size_t i = 0; i < commands.size(); ++i)
+            TEST_ASSERT_EQUAL(i, table.find({"MOC", commands[i]}).value_or(SIZE_MAX));
+        TEST_ASSERT(!table.find({"MOC", "unknown"}));
+    };
+
+    // hashed within the default budget of displacements
+    auto table = Table();
+    table.build(entries());
+    TEST_ASSERT(table.is_perfect());
+    TEST_ASSERT_LESS_OR_EQUAL(Table::default_max_trials, table.trials());
+    expect_lookups(table);
+
+    // the build gives up once its budget is spent, and falls back to a linear scan
+    auto starved = Table(64);
+    starved.build(entries());
+    TEST_ASSERT(!starved.is_perfect());
+    TEST_ASSERT_EQUAL(64, starved.trials());
+    expect_lookups(starved);
+}
+
 void ut_prompt_test_integration() {
     const auto test_f = [&](std::string test_input, const char* expected_reply_raw, bool expected_to_be_valid) {
         auto stripped_test_input = test_input;
@@ -245,6 +383,1315 @@ void ut_prompt_test_integration() {
     }
 }
 
+void ut_prompt_test_reply_writer() {
+    // a reply is written straight into the datalink's outgoing buffer
+    const auto usage_request = std::string("?\n");
+    g_ms->inject_bytestream(std::vector<uint8_t>(usage_request.begin(), usage_request.end()));
+    g_prompt->update();
+
+    const auto reply = g_ms->extract_bytestream();
+    TEST_ASSERT(reply);
+    const auto reply_as_string = std::string(reply->begin(), reply->end());
+    const auto expected_header = std::string("?<OK:[") + std::string(Dialect::API_VERSION) + "]";
+    TEST_ASSERT_EQUAL_STRING(expected_header.c_str(), reply_as_string.substr(0, expected_header.size()).c_str());
+    TEST_ASSERT(reply_as_string.find("  MOC:roVariableWriter") != std::string::npos);
+    TEST_ASSERT_EQUAL_STRING(Dialect::REPLY_CRLF.data(),
+                             reply_as_string.substr(reply_as_string.size() - Dialect::REPLY_CRLF.size()).c_str());
+
+    // a reply that does not fit the outgoing buffer is truncated, but the line is still terminated
+    auto small_ms = std::make_shared<MockStream>(MockStream::Config{.input_buffer_size = 64, .output_buffer_size = 64});
+    auto small_dl = Datalink(small_ms, Datalink::Config{.input_buffer_size = 64, .output_buffer_size = 16});
+    auto writer = small_dl.reply_writer("MOC");
+    TEST_ASSERT(writer.write("0123456"));
+    TEST_ASSERT_FALSE(writer.write("789")); // does not fit
+    TEST_ASSERT(writer.is_truncated());
+    TEST_ASSERT_EQUAL(16, writer.finalize());
+    small_dl.push();
+    const auto truncated = small_ms->extract_bytestream();
+    TEST_ASSERT(truncated);
+    TEST_ASSERT_EQUAL_STRING("MOC<OK:0123456\r\n", std::string(truncated->begin(), truncated->end()).c_str());
+}
+
+void ut_prompt_test_pipelined_burst() {
+    using Clock = std::chrono::steady_clock;
+
+    const size_t burst_size = 20;
+    const auto request = std::string("MOC:roVariable\n");
+    const auto expected_reply = std::string("MOC<OK:42.000000") + std::string(Dialect::REPLY_CRLF);
+
+    const auto extract_replies = [&]() {
+        std::string replies;
+        if (const auto reply = g_ms->extract_bytestream()) replies.append(reply->begin(), reply->end());
+        return replies;
+    };
+
+    const auto run_burst = [&](Prompt& prompt) {
+        std::string burst;
+        for (size_t i = 0; i < burst_size; ++i)
+            burst += request;
+        g_ms->inject_bytestream(std::vector<uint8_t>(burst.begin(), burst.end()));
+
+        // a burst is handled in as few updates as the message budget allows
+        size_t updates = 0;
+        std::string replies;
+        const auto start = Clock::now();
+        while (replies.size() < burst_size * expected_reply.size() && updates < burst_size) {
+            prompt.update();
+            ++updates;
+            replies += extract_replies();
+        }
+        const auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+
+        std::string expected_replies;
+        for (size_t i = 0; i < burst_size; ++i)
+            expected_replies += expected_reply;
+        TEST_ASSERT_EQUAL_STRING(expected_replies.c_str(), replies.c_str());
+
+        char line[96];
+        std::snprintf(line, sizeof(line), "pipelined burst of %i requests: %i updates, %li us", int(burst_size),
+                      int(updates), long(latency));
+        TEST_MESSAGE(line);
+        return updates;
+    };
+
+    // the whole burst fits the message budget: a single update replies to every request
+    auto unbounded_prompt = Prompt({.io_buffer_size = g_ms_io_buffer_size,
+                                    .line_delimiters = "\r\n",
+                                    .max_messages_per_update = burst_size,
+                                    .max_update_duration = k_time_ms(1000)});
+    unbounded_prompt.add_datalink(g_dl);
+    unbounded_prompt.hotload_rpc_recipe(g_mc->rpc_recipe());
+    unbounded_prompt.initialize();
+    TEST_ASSERT_EQUAL(1, run_burst(unbounded_prompt));
+
+    // the message budget spreads the burst over multiple updates
+    auto bounded_prompt = Prompt({.io_buffer_size = g_ms_io_buffer_size,
+                                  .line_delimiters = "\r\n",
+                                  .max_messages_per_update = 8,
+                                  .max_update_duration = k_time_ms(1000)});
+    bounded_prompt.add_datalink(g_dl);
+    bounded_prompt.hotload_rpc_recipe(g_mc->rpc_recipe());
+    bounded_prompt.initialize();
+    TEST_ASSERT_EQUAL(3, run_burst(bounded_prompt));
+}
+
+void ut_prompt_test_batch() {
+    // a batch is split into its requests; a trailing separator does not add a request
+    auto batch = std::string_view("MOC:roVariable;MOC:foo:1;");
+    TEST_ASSERT(IncomingMessageFactory::next_in_batch(batch) == "MOC:roVariable");
+    TEST_ASSERT(IncomingMessageFactory::next_in_batch(batch) == "MOC:foo:1");
+    TEST_ASSERT(batch.empty());
+
+    const auto exchange = [](const std::string& request) {
+        g_ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+        g_prompt->update();
+        const auto reply = g_ms->extract_bytestream();
+        TEST_ASSERT(reply);
+        return std::string(reply->begin(), reply->end());
+    };
+
+    // the requests of a batch are handled in order and replied to in a single line
+    TEST_ASSERT_EQUAL_STRING("MOC<OK:42.000000;MOC<BAD_INPUT;MOC<OK:44.000000;MOC<OK:44.000000\r\n",
+                             exchange("MOC:roVariable;MOC:foo;MOC:rwVariable:2;MOC:rwVariable\n").c_str());
+
+    // a request that cannot be handled does not affect the rest of the batch
+    TEST_ASSERT_EQUAL_STRING("BAD_MESSAGE<MALFORMED_MODULE;BAD_MESSAGE<UNKNOWN_RECIPE;MOC<OK:42.000\r\n",
+                             exchange(":::;FOO:bar;MOC:roVariableWriter\n").c_str());
+}
+
+void ut_prompt_test_binary_mode() {
+    using FrameType = BinaryDialect::FrameType;
+
+    const auto encode_frame = [](FrameType type, uint8_t module_id, uint8_t command_id, const std::string& payload) {
+        std::vector<uint8_t> encoded;
+        const auto sink = [&](const std::string_view& s) { encoded.insert(encoded.end(), s.begin(), s.end()); };
+        auto encoder = framing::FrameEncoder();
+        const char header[] = {static_cast<char>(type), static_cast<char>(module_id), static_cast<char>(command_id)};
+        encoder.put(std::string_view(header, sizeof(header)), sink);
+        encoder.put(payload, sink);
+        encoder.finish(sink);
+        return encoded;
+    };
+    const auto decode_frame = [](std::vector<uint8_t> encoded) {
+        TEST_ASSERT(!encoded.empty());
+        TEST_ASSERT_EQUAL(0, encoded.back());
+        const auto decoded_size = framing::cobs_decode(encoded.data(), encoded.size() - 1);
+        TEST_ASSERT(decoded_size);
+        TEST_ASSERT(*decoded_size >= BinaryDialect::CRC_SIZE);
+        const auto frame = std::string(encoded.begin(), encoded.begin() + *decoded_size - BinaryDialect::CRC_SIZE);
+        const auto crc = static_cast<uint16_t>(encoded[*decoded_size - 2] << 8 | encoded[*decoded_size - 1]);
+        TEST_ASSERT_EQUAL(framing::crc16(frame), crc);
+        return frame;
+    };
+    const auto exchange = [](const std::vector<uint8_t>& request) {
+        g_ms->inject_bytestream(request);
+        g_prompt->update();
+        const auto reply = g_ms->extract_bytestream();
+        TEST_ASSERT(reply);
+        return *reply;
+    };
+    const auto exchange_line = [&](const std::string& request) {
+        const auto reply = exchange(std::vector<uint8_t>(request.begin(), request.end()));
+        return std::string(reply.begin(), reply.end());
+    };
+
+    // framing
+    TEST_ASSERT_EQUAL_HEX16(0x29B1, framing::crc16("123456789"));
+    for (const size_t size : {0, 1, 253, 254, 255, 600}) {
+        std::string payload(size, 'x');
+        for (size_t i = 0; i < size; i += 7)
+            payload[i] = 0;
+        const auto frame = decode_frame(encode_frame(FrameType::REQUEST, 0, 0, payload));
+        TEST_ASSERT(frame.substr(BinaryDialect::HEADER_SIZE) == payload);
+    }
+
+    // the numeric IDs are listed by the usage operant
+    const auto usage = exchange_line("?\n");
+    int module_id = -1, command_id = -1, prompt_id = -1, text_id = -1;
+    TEST_ASSERT_EQUAL(2, std::sscanf(usage.c_str() + usage.find("MOC:roVariableWriter"), "MOC:roVariableWriter @%i.%i",
+                                     &module_id, &command_id));
+    TEST_ASSERT_EQUAL(2, std::sscanf(usage.c_str() + usage.find("Prompt:text"), "Prompt:text @%i.%i", &prompt_id,
+                                     &text_id));
+
+    // the switch is acknowledged in text
+    TEST_ASSERT_EQUAL_STRING("Prompt<OK\r\n", exchange_line("Prompt:binary\n").c_str());
+    TEST_ASSERT(g_dl->mode() == Datalink::Mode::BINARY);
+
+    // floats are replied as raw bytes
+    const auto reply = decode_frame(exchange(encode_frame(FrameType::REQUEST, module_id, command_id, "")));
+    TEST_ASSERT_EQUAL(BinaryDialect::REPLY_HEADER_SIZE + sizeof(float), reply.size());
+    TEST_ASSERT_EQUAL(static_cast<uint8_t>(FrameType::REPLY), static_cast<uint8_t>(reply[0]));
+    TEST_ASSERT_EQUAL(module_id, static_cast<uint8_t>(reply[1]));
+    TEST_ASSERT_EQUAL(command_id, static_cast<uint8_t>(reply[2]));
+    TEST_ASSERT_EQUAL(static_cast<uint8_t>(RPCResult::Status::OK), static_cast<uint8_t>(reply[3]));
+    float value = 0;
+    std::memcpy(&value, reply.data() + BinaryDialect::REPLY_HEADER_SIZE, sizeof(float));
+    TEST_ASSERT_EQUAL_FLOAT(g_mc->roVariable, value);
+
+    // arguments are passed as is
+    const auto rw_reply = decode_frame(exchange(encode_frame(FrameType::REQUEST, module_id, command_id - 2, "2")));
+    TEST_ASSERT_EQUAL_STRING("44.000000", rw_reply.substr(BinaryDialect::REPLY_HEADER_SIZE).c_str());
+
+    // corrupted and unknown requests are answered with an error frame
+    auto corrupted = encode_frame(FrameType::REQUEST, module_id, command_id, "");
+    corrupted[1] ^= 0x10;
+    const auto error = decode_frame(exchange(corrupted));
+    TEST_ASSERT_EQUAL(static_cast<uint8_t>(FrameType::ERROR), static_cast<uint8_t>(error[0]));
+    TEST_ASSERT_EQUAL_STRING("BAD_CHECKSUM", error.substr(BinaryDialect::HEADER_SIZE).c_str());
+    const auto unknown = decode_frame(exchange(encode_frame(FrameType::REQUEST, module_id, 200, "")));
+    TEST_ASSERT_EQUAL_STRING("UNKNOWN_MODEL", unknown.substr(BinaryDialect::HEADER_SIZE).c_str());
+
+    // unsolicited messages are framed as well
+    TEST_ASSERT(g_prompt->publish("MOC", 0x01020304, 8, [](ReplyWriter& reply) { reply.write(g_mc->roVariable); }));
+    g_prompt->update();
+    const auto published = decode_frame(*g_ms->extract_bytestream());
+    TEST_ASSERT_EQUAL(BinaryDialect::HEADER_SIZE + sizeof(uint32_t) + sizeof(float), published.size());
+    TEST_ASSERT_EQUAL(static_cast<uint8_t>(FrameType::PUBLISH), static_cast<uint8_t>(published[0]));
+    TEST_ASSERT_EQUAL(module_id, static_cast<uint8_t>(published[1]));
+    TEST_ASSERT_EQUAL_STRING("\x04\x03\x02\x01", published.substr(BinaryDialect::HEADER_SIZE, 4).c_str());
+
+    // the switch back is acknowledged in binary, after which the text dialect is spoken again
+    const auto text_reply = decode_frame(exchange(encode_frame(FrameType::REQUEST, prompt_id, text_id, "")));
+    TEST_ASSERT_EQUAL(BinaryDialect::REPLY_HEADER_SIZE, text_reply.size());
+    TEST_ASSERT(g_dl->mode() == Datalink::Mode::TEXT);
+    TEST_ASSERT_EQUAL_STRING("MOC<OK:42.000\r\n", exchange_line("MOC:roVariableWriter\n").c_str());
+
+    // bytes following a switch in the same burst are read in the new mode, in either direction
+    const auto exchange_burst = [&](std::vector<uint8_t> burst, const std::vector<uint8_t>& tail) {
+        burst.insert(burst.end(), tail.begin(), tail.end());
+        g_ms->inject_bytestream(burst);
+        std::vector<uint8_t> replies;
+        for (int i = 0; i < 3; ++i) {
+            g_prompt->update();
+            const auto reply = g_ms->extract_bytestream();
+            if (reply) replies.insert(replies.end(), reply->begin(), reply->end());
+        }
+        return replies;
+    };
+    const auto to_bytes = [](const std::string& s) { return std::vector<uint8_t>(s.begin(), s.end()); };
+    const auto ack = std::string("Prompt<OK\r\n");
+    const auto request = encode_frame(FrameType::REQUEST, module_id, command_id, "");
+    auto replies = exchange_burst(to_bytes("Prompt:binary\n"), request);
+    TEST_ASSERT(g_dl->mode() == Datalink::Mode::BINARY);
+    TEST_ASSERT(std::equal(ack.begin(), ack.end(), replies.begin()));
+    const auto burst_reply = decode_frame(std::vector<uint8_t>(replies.begin() + ack.size(), replies.end()));
+    TEST_ASSERT_EQUAL(BinaryDialect::REPLY_HEADER_SIZE + sizeof(float), burst_reply.size());
+
+    const auto text_request = encode_frame(FrameType::REQUEST, prompt_id, text_id, "");
+    replies = exchange_burst(text_request, to_bytes("MOC:roVariableWriter\n"));
+    TEST_ASSERT(g_dl->mode() == Datalink::Mode::TEXT);
+    const auto frame_end = std::find(replies.begin(), replies.end(), 0) + 1;
+    const auto text_ack = decode_frame(std::vector<uint8_t>(replies.begin(), frame_end));
+    TEST_ASSERT_EQUAL(BinaryDialect::REPLY_HEADER_SIZE, text_ack.size());
+    TEST_ASSERT_EQUAL_STRING("MOC<OK:42.000\r\n", std::string(frame_end, replies.end()).c_str());
+}
+
+void ut_prompt_test_publish() {
+    const auto write_row = [](ReplyWriter& reply) {
+        reply.write(g_mc->roVariable, 3);
+        reply.write(Dialect::VALUE_SEPARATOR);
+        reply.write(g_mc->rwVariable, 3);
+    };
+    const auto extract = []() {
+        const auto published = g_ms->extract_bytestream();
+        return published ? std::string(published->begin(), published->end()) : std::string();
+    };
+
+    // an unsolicited message is tagged with its sequence number and pushed out on the next update
+    TEST_ASSERT(g_prompt->publish("MOC", 7, 32, write_row));
+    TEST_ASSERT_EQUAL_STRING("", extract().c_str());
+    g_prompt->update();
+    TEST_ASSERT_EQUAL_STRING("MOC!7:42.000|42.000\r\n", extract().c_str());
+
+    // a message that cannot be guaranteed to fit the outgoing buffer is dropped instead of blocking
+    const auto row = std::string("MOC!1:42.000|42.000\r\n");
+    size_t published = 0;
+    while (g_prompt->publish("MOC", 1, 32, write_row))
+        ++published;
+    TEST_ASSERT(published > 0);
+    TEST_ASSERT(g_dl->tx_available() >= 32);
+    TEST_ASSERT(g_dl->tx_available() < 32 + row.size() + 10 /* sequence */);
+
+    // nothing was truncated and the buffer is drained on the next update
+    g_prompt->update();
+    const auto rows = extract();
+    TEST_ASSERT_EQUAL(published * row.size(), rows.size());
+    TEST_ASSERT_EQUAL_STRING(row.c_str(), rows.substr(rows.size() - row.size()).c_str());
+    TEST_ASSERT(g_prompt->publish("MOC", 1, 32, write_row));
+}
+
+void ut_prompt_test_tickets() {
+    const auto exchange = [](const std::string& request) {
+        g_ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+        g_prompt->update();
+        const auto reply = g_ms->extract_bytestream();
+        return reply ? std::string(reply->begin(), reply->end()) : std::string();
+    };
+    const auto extract = []() {
+        g_prompt->update();
+        const auto published = g_ms->extract_bytestream();
+        return published ? std::string(published->begin(), published->end()) : std::string();
+    };
+
+    auto& tickets = g_prompt->tickets();
+    const auto id = tickets.issue("MOC");
+    TEST_ASSERT(id);
+    const auto tag = std::to_string(*id);
+
+    // a running operation is polled, and its progress is published as it is posted
+    TEST_ASSERT_EQUAL_STRING("Prompt<OK:RUNNING||0\r\n", exchange("Prompt:ticket:" + tag + "\n").c_str());
+    tickets.post_progress(*id, "tuning");
+    TEST_ASSERT_EQUAL_STRING(("MOC!" + tag + ":RUNNING|tuning|0\r\n").c_str(), extract().c_str());
+    tickets.post_progress(*id, "tuning"); // unchanged phase; nothing is published
+    TEST_ASSERT_EQUAL_STRING("", extract().c_str());
+
+    // the result of a completed operation is published and kept until the ticket is recycled
+    tickets.complete(*id, RPCResult("1.0|2.0|3.0"));
+    TEST_ASSERT_EQUAL_STRING(("MOC!" + tag + ":DONE|OK|1.0|2.0|3.0\r\n").c_str(), extract().c_str());
+    TEST_ASSERT_EQUAL_STRING("Prompt<OK:DONE|OK|1.0|2.0|3.0\r\n", exchange("Prompt:ticket:" + tag + "\n").c_str());
+
+    // while a blocking operation serves its ticket, no other RPC is invoked
+    const auto serve = [](const std::string& request) {
+        g_ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+        g_prompt->serve_tickets();
+        const auto reply = g_ms->extract_bytestream();
+        return reply ? std::string(reply->begin(), reply->end()) : std::string();
+    };
+    TEST_ASSERT_EQUAL_STRING("Prompt<OK:DONE|OK|1.0|2.0|3.0\r\n", serve("Prompt:ticket:" + tag + "\n").c_str());
+    const auto rw_variable = g_mc->rwVariable;
+    TEST_ASSERT_EQUAL_STRING("MOC<BUSY\r\n", serve("MOC:rwVariable:1\n").c_str());
+    TEST_ASSERT_EQUAL_FLOAT(rw_variable, g_mc->rwVariable);
+    TEST_ASSERT_EQUAL_STRING("MOC<OK:42.000\r\n", exchange("MOC:roVariableWriter\n").c_str());
+
+    // unknown tickets are rejected
+    TEST_ASSERT_EQUAL_STRING("Prompt<BAD_INPUT\r\n", exchange("Prompt:ticket:0\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("Prompt<BAD_INPUT\r\n", exchange("Prompt:ticket:foo\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("Prompt<BAD_INPUT\r\n", exchange("Prompt:ticket\n").c_str());
+
+    // tickets of running operations are never recycled; the oldest completed ticket is
+    std::vector<RPCTicket::Id> running;
+    while (const auto next = tickets.issue("MOC"))
+        running.push_back(*next);
+    TEST_ASSERT_EQUAL(prompt_cfg.max_tickets, running.size());
+    TEST_ASSERT_NULL(tickets.find(*id));
+    tickets.complete(running.front(), RPCResult(RPCResult::Status::BAD_INPUT));
+    TEST_ASSERT(tickets.issue("MOC"));
+    TEST_ASSERT_NULL(tickets.find(running.front()));
+    TEST_ASSERT_FALSE(tickets.issue("MOC"));
+
+    // the oldest completed ticket is recycled first, also once the ids wrap around
+    auto office = RPCTicketOffice({.max_tickets = 2});
+    auto previous = RPCTicket::Id(0);
+    for (auto issued = office.issue("MOC"); issued; issued = office.issue("MOC")) {
+        office.complete(*issued, RPCResult(RPCResult::Status::OK));
+        if (*issued < previous) { // wrapped; `previous` is the oldest ticket kept
+            TEST_ASSERT(office.issue("MOC"));
+            TEST_ASSERT_NULL(office.find(previous));
+            TEST_ASSERT(office.find(*issued));
+            break;
+        }
+        previous = *issued;
+    }
+}
+
+void ut_prompt_test_streamed_reply() {
+    constexpr size_t line_count = 300;
+    const auto lines = [](ReplyWriter& reply) {
+        reply.stream([line = size_t(0)](ReplyWriter& reply) mutable {
+            char text[16];
+            reply.write(std::string_view(text, std::snprintf(text, sizeof(text), "line %03i|", int(line))));
+            return ++line < line_count;
+        });
+    };
+    const auto gen_recipe = [lines]() {
+        return std::make_unique<RPCRecipe>(RPCRecipe(
+            "GEN", {RPCModel("lines", [lines](const OptStringView&, ReplyWriter& reply) { lines(reply); })}));
+    };
+
+    // a single message per update, so that every update resumes the streamed reply at most once
+    auto prompt = Prompt(Prompt::Config{.io_buffer_size = g_ms_io_buffer_size, .max_messages_per_update = 1});
+    prompt.add_datalink(std::make_shared<Datalink>(g_ms, g_dl_cfg));
+    prompt.hotload_rpc_recipe(g_mc->rpc_recipe());
+    prompt.hotload_rpc_recipe(gen_recipe());
+    prompt.initialize();
+
+    std::string expected = "GEN<OK:";
+    for (size_t i = 0; i < line_count; ++i) {
+        char text[16];
+        expected.append(text, std::snprintf(text, sizeof(text), "line %03i|", int(i)));
+    }
+    expected += Dialect::REPLY_CRLF;
+    TEST_ASSERT(expected.size() > 2 * g_ms_io_buffer_size);
+
+    // a reply larger than the outgoing buffer is streamed across updates, as the buffer drains
+    const auto request = std::string("GEN:lines\nMOC:roVariable\n");
+    g_ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+    std::string replies;
+    size_t updates = 0;
+    for (; updates < 10 && replies.find("MOC<") == std::string::npos; ++updates) {
+        prompt.update();
+        if (const auto pushed = g_ms->extract_bytestream()) replies.append(pushed->begin(), pushed->end());
+        if (replies.size() < expected.size()) { // nothing is published into a reply that is being streamed
+            TEST_ASSERT_FALSE(prompt.publish("MOC", 1, 0, [](ReplyWriter&) {}));
+        }
+    }
+    TEST_ASSERT(updates > 2);
+
+    // the next request is only handled once the streamed reply is complete
+    TEST_ASSERT_EQUAL_STRING((expected + "MOC<OK:42.000000\r\n").c_str(), replies.c_str());
+
+    // a streamed reply that is not the last of a batch is truncated instead
+    const auto batch = std::string("GEN:lines;MOC:roVariable\n");
+    g_ms->inject_bytestream(std::vector<uint8_t>(batch.begin(), batch.end()));
+    prompt.update();
+    const auto pushed = g_ms->extract_bytestream();
+    TEST_ASSERT(pushed);
+    const auto truncated = std::string(pushed->begin(), pushed->end());
+    const auto tail = std::string(";MOC<OK:42.000000\r\n");
+    TEST_ASSERT(truncated.size() <= g_ms_io_buffer_size);
+    TEST_ASSERT_EQUAL_STRING(expected.substr(0, truncated.size() - tail.size()).c_str(),
+                             truncated.substr(0, truncated.size() - tail.size()).c_str());
+    TEST_ASSERT_EQUAL_STRING(tail.c_str(), truncated.substr(truncated.size() - tail.size()).c_str());
+
+    // a reply collected into an `RPCResult` is never truncated
+    auto rpc_factory = RPCFactory(RPCFactory::Config{});
+    rpc_factory.hotload_rpc_recipe(gen_recipe());
+    auto message = IncomingMessageFactory::from_view("GEN:lines");
+    TEST_ASSERT(message);
+    auto rpc = rpc_factory.from_message(*message);
+    TEST_ASSERT(rpc);
+    const auto result = rpc->invoke();
+    TEST_ASSERT(result.return_value);
+    TEST_ASSERT_EQUAL_STRING(expected.substr(7, expected.size() - 9).c_str(), result.return_value->c_str());
+}
+
+void ut_prompt_test_allocation_budgets() {
+    using kaskas::core::AllocationTracker;
+    if (!AllocationTracker::is_enabled) TEST_IGNORE_MESSAGE("allocations are not tracked in this build");
+
+    // returns the allocations made by the RPC labelled `label` while handling `request`
+    const auto allocations_of = [](const std::string& request, const std::string_view& label) {
+        AllocationTracker::reset();
+        g_ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+        g_prompt->update();
+        TEST_ASSERT(g_ms->extract_bytestream());
+        const auto scope = AllocationTracker::find(label);
+        TEST_ASSERT_NOT_NULL(scope);
+        return scope ? scope->stats.allocations : SIZE_MAX;
+    };
+
+    // a model returning an `RPCResult` allocates its return value at most
+    TEST_ASSERT_LESS_OR_EQUAL(1, allocations_of("MOC:roVariable\n", "MOC:roVariable"));
+    TEST_ASSERT_LESS_OR_EQUAL(1, allocations_of("MOC:rwVariable:2\n", "MOC:rwVariable"));
+
+    // a model writing its reply writes straight into the outgoing buffer
+    TEST_ASSERT_EQUAL(0, allocations_of("MOC:roVariableWriter\n", "MOC:roVariableWriter"));
+
+    // the usage listing is streamed straight into the outgoing buffer
+    TEST_ASSERT_EQUAL(0, allocations_of("?\n", "?"));
+}
+
+void ut_prompt_test_tickets_served_while_blocked() {
+    // a UART that is only polled from the main loop, as on target; the main loop is blocked by the handler below
+    auto uart = std::make_shared<MockStream>(
+        MockStream::Config{.input_buffer_size = g_ms_io_buffer_size, .output_buffer_size = g_ms_io_buffer_size});
+    auto stream = std::make_shared<InterruptStream>(uart, InterruptStream::Config{});
+    auto prompt = Prompt(Prompt::Config{.io_buffer_size = g_ms_io_buffer_size});
+    prompt.add_datalink(std::make_shared<Datalink>(stream, g_dl_cfg));
+    prompt.set_stream_poller([stream]() { stream->poll(); });
+    prompt.hotload_rpc_recipe(g_mc->rpc_recipe());
+    prompt.initialize();
+
+    const auto id = prompt.tickets().issue("MOC");
+    TEST_ASSERT(id);
+    const auto request = "Prompt:ticket:" + std::to_string(*id) + "\n";
+    uart->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+
+    // a blocking event handler, such as an autotune, serves the tickets from its process loop
+    const auto blocking_handler = [&prompt]() {
+        for (size_t i = 0; i < 3; ++i)
+            prompt.serve_tickets();
+    };
+    blocking_handler();
+    const auto reply = uart->extract_bytestream();
+    TEST_ASSERT(reply);
+    TEST_ASSERT_EQUAL_STRING("Prompt<OK:RUNNING||0\r\n", std::string(reply->begin(), reply->end()).c_str());
+}
+
+void ut_prompt_test_reply_cache() {
+    size_t constant_calls = 0;
+    size_t ttl_calls = 0;
+    size_t streamed_calls = 0;
+    g_prompt->hotload_rpc_recipe(std::make_unique<RPCRecipe>(RPCRecipe(
+        "CCH", {
+                   RPCModel(
+                       "constant",
+                       [&constant_calls](const OptStringView& arg) {
+                           ++constant_calls;
+                           return RPCResult(arg ? std::string(*arg) : std::string("value"));
+                       },
+                       "", RPCModel::CachePolicy::constant()),
+                   RPCModel(
+                       "ttl", [&ttl_calls](const OptStringView&) { return RPCResult(std::to_string(++ttl_calls)); },
+                       "", RPCModel::CachePolicy::time_to_live(k_time_ms(50))),
+                   RPCModel(
+                       "streamed",
+                       [&streamed_calls](const OptStringView&, ReplyWriter& reply) {
+                           ++streamed_calls;
+                           reply.stream([chunks = size_t(0)](ReplyWriter& reply) mutable {
+                               reply.write(std::string_view("0123456789"));
+                               return ++chunks < 200;
+                           });
+                       },
+                       "", RPCModel::CachePolicy::constant()),
+               })));
+    const auto exchange = [](const std::string& request) { // a reply may take several updates
+        g_ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+        auto replies = std::string();
+        for (size_t i = 0; i < 8; ++i) {
+            g_prompt->update();
+            if (const auto reply = g_ms->extract_bytestream()) replies.append(reply->begin(), reply->end());
+        }
+        return replies;
+    };
+
+    // a constant reply is built once and served from the cache ever after
+    TEST_ASSERT_EQUAL_STRING("CCH<OK:value\r\n", exchange("CCH:constant\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("CCH<OK:value\r\n", exchange("CCH:constant\n").c_str());
+    TEST_ASSERT_EQUAL(1, constant_calls);
+
+    // a request with arguments is never served from the cache
+    TEST_ASSERT_EQUAL_STRING("CCH<OK:argument\r\n", exchange("CCH:constant:argument\n").c_str());
+    TEST_ASSERT_EQUAL(2, constant_calls);
+    TEST_ASSERT_EQUAL_STRING("CCH<OK:value\r\n", exchange("CCH:constant\n").c_str());
+
+    // a reply with a time to live is rebuilt once it has expired
+    TEST_ASSERT_EQUAL_STRING("CCH<OK:1\r\n", exchange("CCH:ttl\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("CCH<OK:1\r\n", exchange("CCH:ttl\n").c_str());
+    HAL::delay(k_time_ms(60));
+    TEST_ASSERT_EQUAL_STRING("CCH<OK:2\r\n", exchange("CCH:ttl\n").c_str());
+
+    // a streamed reply is never cached, as that would build it in memory; it is streamed straight into the link
+    std::string streamed = "CCH<OK:";
+    for (size_t i = 0; i < 200; ++i)
+        streamed += "0123456789";
+    streamed += "\r\n";
+    TEST_ASSERT_EQUAL_STRING(streamed.c_str(), exchange("CCH:streamed\n").c_str());
+    TEST_ASSERT_EQUAL_STRING(streamed.c_str(), exchange("CCH:streamed\n").c_str());
+    TEST_ASSERT_EQUAL(2, streamed_calls);
+
+    // hits and misses are counted; misses are the first `constant`, `ttl` twice and `streamed` twice
+    TEST_ASSERT_EQUAL(3, g_prompt->reply_cache().stats().hits);
+    TEST_ASSERT_EQUAL(5, g_prompt->reply_cache().stats().misses);
+    TEST_ASSERT_EQUAL_STRING("Prompt<OK:3|5\r\n", exchange("Prompt:cacheStats\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("Prompt<OK:0|0\r\n", exchange("Prompt:cacheStats:reset\n").c_str());
+}
+
+void ut_prompt_test_reply_cache_streamed_across_links() {
+    // link A drains through an `InterruptStream` that is not polled until the end: its writer stalls
+    auto uart = std::make_shared<MockStream>(
+        MockStream::Config{.input_buffer_size = g_ms_io_buffer_size, .output_buffer_size = g_ms_io_buffer_size});
+    auto stalled = std::make_shared<InterruptStream>(uart, InterruptStream::Config{.tx_buffer_size = 64});
+    auto other = std::make_shared<MockStream>(
+        MockStream::Config{.input_buffer_size = g_ms_io_buffer_size, .output_buffer_size = g_ms_io_buffer_size});
+    auto prompt = Prompt(Prompt::Config{.io_buffer_size = g_ms_io_buffer_size, .max_cached_replies = 2});
+    prompt.add_datalink(std::make_shared<Datalink>(stalled, g_dl_cfg));
+    prompt.add_datalink(std::make_shared<Datalink>(other, g_dl_cfg));
+    constexpr size_t reply_size = 3000; // well beyond the outgoing buffers
+    char fill = 'a';
+    prompt.hotload_rpc_recipe(std::make_unique<RPCRecipe>(RPCRecipe(
+        "CCH", {
+                   RPCModel(
+                       "ttl", [&fill](const OptStringView&) { return RPCResult(std::string(reply_size, fill++)); },
+                       "", RPCModel::CachePolicy::time_to_live(k_time_ms(50))),
+                   RPCModel(
+                       "other", [](const OptStringView&) { return RPCResult("other"); }, "",
+                       RPCModel::CachePolicy::constant()),
+               })));
+    prompt.initialize();
+    const auto request = [](MockStream& ms, const std::string& bytes) {
+        ms.inject_bytestream(std::vector<uint8_t>(bytes.begin(), bytes.end()));
+    };
+    const auto reply = [](MockStream& ms) {
+        const auto bytes = ms.extract_bytestream();
+        return bytes ? std::string(bytes->begin(), bytes->end()) : std::string();
+    };
+    const auto filled_reply = [](char fill) { return "CCH<OK:" + std::string(reply_size, fill) + "\r\n"; };
+    const auto exchange = [&](const std::string& bytes) { // on link B, whose reply may take several updates
+        request(*other, bytes);
+        std::string replied;
+        for (size_t i = 0; i < 8; ++i) {
+            prompt.update();
+            replied += reply(*other);
+        }
+        return replied;
+    };
+
+    for (const auto c : std::string_view("CCH:ttl\n"))
+        stalled->receive(static_cast<uint8_t>(c)); // link A's RX interrupt
+    prompt.update();
+    TEST_ASSERT_EQUAL(1, prompt.reply_cache().stats().misses);
+
+    // while link A streams the cached reply, link B neither overwrites nor evicts it: the refreshed reply takes the
+    // other entry, which is evicted in turn
+    HAL::delay(k_time_ms(60));
+    TEST_ASSERT_EQUAL_STRING(filled_reply('b').c_str(), exchange("CCH:ttl\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("CCH<OK:other\r\n", exchange("CCH:other\n").c_str());
+
+    // link A's reply is the one cached when it was requested
+    std::string stalled_reply;
+    for (size_t i = 0; i < 200 && !prompt.is_idle(); ++i) {
+        stalled->poll();
+        stalled_reply += reply(*uart);
+        prompt.update();
+    }
+    stalled->poll();
+    stalled_reply += reply(*uart);
+    TEST_ASSERT_EQUAL_STRING(filled_reply('a').c_str(), stalled_reply.c_str());
+
+    // once streamed, the entry of link A is released and takes the next refresh
+    TEST_ASSERT_EQUAL_STRING(filled_reply('c').c_str(), exchange("CCH:ttl\n").c_str());
+    TEST_ASSERT_EQUAL_STRING(filled_reply('c').c_str(), exchange("CCH:ttl\n").c_str());
+}
+
+void ut_prompt_test_interrupt_stream() {
+    // the prompt on top of an `InterruptStream`, whose RX interrupt is played by the test or by a thread
+    auto uart = std::make_shared<MockStream>(
+        MockStream::Config{.input_buffer_size = g_ms_io_buffer_size, .output_buffer_size = g_ms_io_buffer_size});
+    auto rx = std::make_shared<InterruptStream>(uart, InterruptStream::Config{.rx_buffer_size = 64});
+    auto prompt = Prompt(Prompt::Config{.io_buffer_size = g_ms_io_buffer_size});
+    prompt.add_datalink(std::make_shared<Datalink>(rx, g_dl_cfg));
+    prompt.hotload_rpc_recipe(g_mc->rpc_recipe());
+    prompt.initialize();
+    const auto interrupt = [&rx](const std::string& bytes) {
+        for (const auto c : bytes)
+            rx->receive(static_cast<uint8_t>(c));
+    };
+    const auto reply = [&uart, &rx]() {
+        rx->poll(); // drains the TX ring into the UART
+        const auto bytes = uart->extract_bytestream();
+        return bytes ? std::string(bytes->begin(), bytes->end()) : std::string();
+    };
+
+    // a line is signalled once, as soon as its delimiter is received
+    interrupt("MOC:roVar");
+    TEST_ASSERT_FALSE(rx->take_line_ready());
+    interrupt("iable\n");
+    TEST_ASSERT_TRUE(rx->take_line_ready());
+    TEST_ASSERT_FALSE(rx->take_line_ready());
+    prompt.update();
+    TEST_ASSERT_EQUAL_STRING("MOC<OK:42.000000\r\n", reply().c_str());
+    TEST_ASSERT_TRUE(prompt.is_idle());
+
+    // bytes received while the ring buffer is full are dropped and counted
+    interrupt(std::string(100, 'x'));
+    TEST_ASSERT_EQUAL(63, rx->available());
+    TEST_ASSERT_EQUAL(37, rx->overruns());
+    uint8_t drain[64];
+    TEST_ASSERT_EQUAL(63, rx->read(drain, sizeof(drain)));
+    TEST_ASSERT_EQUAL(0, rx->available());
+
+    // lines received concurrently arrive whole and in order, however the ring buffer wraps
+    constexpr size_t line_count = 500;
+    auto isr = std::thread([&rx]() {
+        constexpr auto line = std::string_view("MOC:rwVariable:0\n"); // the interrupt never allocates
+        for (size_t i = 0; i < line_count; ++i) {
+            for (size_t sent = 0; sent < line.size();) {
+                if (rx->available() + 1 < 64) rx->receive(static_cast<uint8_t>(line[sent++]));
+                else std::this_thread::yield();
+            }
+        }
+    });
+    size_t replies = 0;
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (replies < line_count && std::chrono::steady_clock::now() < deadline) {
+        if (!rx->take_line_ready()) continue;
+        prompt.update();
+        for (const auto c : reply())
+            replies += c == '\n';
+    }
+    isr.join();
+    prompt.update();
+    for (const auto c : reply())
+        replies += c == '\n';
+    TEST_ASSERT_EQUAL(line_count, replies);
+    TEST_ASSERT_EQUAL(37, rx->overruns());
+}
+
+void ut_prompt_test_interrupt_stream_tx() {
+    // a UART at 115200 baud, played by a mock stream that takes every byte at once and by the stream's own pacing
+    auto uart = std::make_shared<MockStream>(MockStream::Config{.input_buffer_size = 2048, .output_buffer_size = 2048});
+    auto stream = InterruptStream(uart, InterruptStream::Config{.tx_buffer_size = 1025, .baud_rate = 115200});
+    auto reply = std::vector<uint8_t>(1024 + 16);
+    for (size_t i = 0; i < reply.size(); ++i)
+        reply[i] = static_cast<uint8_t>(i);
+
+    // a write never blocks; what does not fit the TX ring is refused and counted
+    const auto written_at = HAL::micros();
+    auto since_write = spn::structure::time::Timer();
+    TEST_ASSERT_EQUAL(1024, stream.write(reply.data(), reply.size()));
+    TEST_ASSERT(since_write.time_since_last(false) < k_time_ms(5));
+    TEST_ASSERT_EQUAL(1024, stream.tx_stats().queued);
+    TEST_ASSERT_EQUAL(16, stream.tx_stats().refused_bytes);
+    TEST_ASSERT_EQUAL(1024, stream.tx_stats().high_water);
+
+    // a retry of the refused bytes that is refused again counts them again
+    TEST_ASSERT_EQUAL(0, stream.write(reply.data() + 1024, 16));
+    TEST_ASSERT_EQUAL(32, stream.tx_stats().refused_bytes);
+
+    // the TX ring drains no faster than the line carries it, plus the UART driver's buffer
+    auto transmitted = std::vector<uint8_t>();
+    const auto bytes_per_us = 115200.0f / 10 / 1e6f;
+    while (stream.tx_pending() > 0 && since_write.time_since_last(false) < k_time_ms(2000)) {
+        stream.poll();
+        if (const auto bytes = uart->extract_bytestream())
+            transmitted.insert(transmitted.end(), bytes->begin(), bytes->end());
+        const auto carried = (HAL::micros() - written_at).raw<float>() * bytes_per_us;
+        TEST_ASSERT(transmitted.size() <= 64 + static_cast<size_t>(carried) + 1);
+        HAL::delay_us(k_time_us(500));
+    }
+    TEST_ASSERT_EQUAL(1024, transmitted.size());
+    TEST_ASSERT(std::equal(transmitted.begin(), transmitted.end(), reply.begin()));
+    TEST_ASSERT(since_write.time_since_last(false) >= k_time_ms(75)); // (1024 - 64) bytes at 11.52 bytes per ms
+
+    // bytes taken by the TX interrupt are not handed to the UART again
+    stream.write(reply.data(), 8);
+    uint8_t byte = 0;
+    TEST_ASSERT_EQUAL(1, stream.transmit(&byte, 1));
+    TEST_ASSERT_EQUAL(0, byte);
+    TEST_ASSERT_EQUAL(7, stream.tx_pending());
+}
+
+void ut_prompt_test_baud_negotiation() {
+    auto uart = std::make_shared<MockStream>(MockStream::Config{.input_buffer_size = 256, .output_buffer_size = 256});
+    auto switches = std::vector<uint32_t>();
+    auto stream = std::make_shared<InterruptStream>(
+        uart, InterruptStream::Config{.baud_rate = 115200,
+                                      .max_baud_rate = 921600,
+                                      .baud_rate_confirm_timeout = k_time_ms(100),
+                                      .switch_baud_rate = [&switches](uint32_t baud) { switches.push_back(baud); }});
+    auto prompt = Prompt(Prompt::Config{.io_buffer_size = g_ms_io_buffer_size});
+    prompt.add_datalink(std::make_shared<Datalink>(stream, g_dl_cfg));
+    prompt.hotload_rpc_recipe(stream->rpc_recipe());
+    prompt.initialize();
+
+    const auto exchange = [&](const std::string& request) {
+        for (const auto c : request)
+            stream->receive(static_cast<uint8_t>(c)); // as the RX interrupt would
+        prompt.update();
+        auto replies = std::string();
+        for (auto since = spn::structure::time::Timer(); since.time_since_last(false) < k_time_ms(20);) {
+            stream->poll(); // drains the reply at the line's pace
+            if (const auto bytes = uart->extract_bytestream()) replies.append(bytes->begin(), bytes->end());
+            HAL::delay_us(k_time_us(500));
+        }
+        return replies;
+    };
+    const auto wait = [&](k_time_ms duration) {
+        for (auto since = spn::structure::time::Timer(); since.time_since_last(false) < duration;) {
+            stream->poll();
+            HAL::delay_us(k_time_us(500));
+        }
+    };
+
+    // the rate is switched once its acknowledgement is transmitted, and switched back when it is not confirmed in time
+    TEST_ASSERT_EQUAL_STRING("UART<OK:115200\r\n", exchange("UART:baud\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("UART<OK:115200\r\n", exchange("UART:baud:921600\n").c_str());
+    TEST_ASSERT_EQUAL(1, switches.size());
+    TEST_ASSERT_EQUAL(921600, stream->baud_rate());
+    wait(k_time_ms(110));
+    TEST_ASSERT_EQUAL(2, switches.size());
+    TEST_ASSERT_EQUAL(115200, switches.back());
+    TEST_ASSERT_EQUAL(115200, stream->baud_rate());
+
+    // a confirmed rate is kept
+    TEST_ASSERT_EQUAL_STRING("UART<OK:115200\r\n", exchange("UART:baud:230400\n").c_str());
+    TEST_ASSERT_EQUAL(230400, stream->baud_rate());
+    TEST_ASSERT_EQUAL_STRING("UART<OK:230400\r\n", exchange("UART:confirmBaud\n").c_str());
+    wait(k_time_ms(110));
+    TEST_ASSERT_EQUAL(3, switches.size());
+    TEST_ASSERT_EQUAL(230400, stream->baud_rate());
+
+    // rates beyond the maximum, and confirmations without a switch, are refused
+    TEST_ASSERT_EQUAL_STRING("UART<BAD_INPUT\r\n", exchange("UART:baud:2000000\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("UART<BAD_INPUT\r\n", exchange("UART:baud:fast\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("UART<BAD_INPUT\r\n", exchange("UART:confirmBaud\n").c_str());
+    TEST_ASSERT_EQUAL(3, switches.size());
+}
+
+void ut_prompt_test_baud_negotiation_with_datalink() {
+    // a TX ring smaller than the acknowledgement, which partly waits in the datalink's outgoing buffer
+    auto uart = std::make_shared<MockStream>(MockStream::Config{.input_buffer_size = 256, .output_buffer_size = 256});
+    auto switches = std::vector<uint32_t>();
+    auto stream = std::make_shared<InterruptStream>(
+        uart, InterruptStream::Config{.tx_buffer_size = 8,
+                                      .baud_rate = 115200,
+                                      .max_baud_rate = 921600,
+                                      .switch_baud_rate = [&switches](uint32_t baud) { switches.push_back(baud); }});
+    auto dl = std::make_shared<Datalink>(stream, g_dl_cfg);
+    stream->attach_datalink(dl);
+    auto prompt = Prompt(Prompt::Config{.io_buffer_size = g_ms_io_buffer_size});
+    prompt.add_datalink(dl);
+    prompt.hotload_rpc_recipe(stream->rpc_recipe());
+    prompt.initialize();
+
+    const auto receive = [&stream](const std::string& bytes) {
+        for (const auto c : bytes)
+            stream->receive(static_cast<uint8_t>(c)); // as the RX interrupt would
+    };
+    auto replies = std::string();
+    const auto drain = [&](bool is_updating) {
+        for (auto since = spn::structure::time::Timer(); since.time_since_last(false) < k_time_ms(20);) {
+            if (is_updating) prompt.update();
+            stream->poll();
+            if (const auto bytes = uart->extract_bytestream()) replies.append(bytes->begin(), bytes->end());
+            HAL::delay_us(k_time_us(500));
+        }
+    };
+
+    // the rate is switched once the acknowledgement has left the datalink, not just the TX ring; bytes received at the
+    // former rate and already read by the datalink are dropped
+    receive("UART:baud:921600\nnoise");
+    prompt.update();
+    TEST_ASSERT(dl->tx_pending() > 0);
+    drain(false);
+    TEST_ASSERT_EQUAL(0, switches.size());
+    drain(true);
+    TEST_ASSERT_EQUAL(1, switches.size());
+    TEST_ASSERT_EQUAL(921600, stream->baud_rate());
+    TEST_ASSERT_EQUAL_STRING("UART<OK:115200\r\n", replies.c_str());
+
+    replies.clear();
+    receive("UART:confirmBaud\n");
+    drain(true);
+    TEST_ASSERT_EQUAL_STRING("UART<OK:921600\r\n", replies.c_str());
+}
+
+void ut_prompt_test_multiple_datalinks() {
+    // a chatty and a quiet host, each on their own link
+    const auto make_stream = []() {
+        auto ms = std::make_shared<MockStream>(
+            MockStream::Config{.input_buffer_size = g_ms_io_buffer_size, .output_buffer_size = g_ms_io_buffer_size});
+        ms->initialize();
+        return ms;
+    };
+    auto chatty = make_stream();
+    auto quiet = make_stream();
+    auto prompt = Prompt(Prompt::Config{.io_buffer_size = g_ms_io_buffer_size, .max_messages_per_update = 2});
+    prompt.add_datalink(std::make_shared<Datalink>(chatty, g_dl_cfg));
+    prompt.add_datalink(std::make_shared<Datalink>(quiet, g_dl_cfg));
+    prompt.hotload_rpc_recipe(g_mc->rpc_recipe());
+    prompt.initialize();
+
+    const auto inject = [](MockStream& ms, const std::string& bytes) {
+        ms.inject_bytestream(std::vector<uint8_t>(bytes.begin(), bytes.end()));
+    };
+    const auto replies = [](MockStream& ms) {
+        const auto bytes = ms.extract_bytestream();
+        size_t count = 0;
+        if (bytes) count = std::count(bytes->begin(), bytes->end(), '\n');
+        return count;
+    };
+
+    // every link is serviced within its own budget; the chatty host does not stall the quiet one
+    for (size_t i = 0; i < 10; ++i)
+        inject(*chatty, "MOC:roVariable\n");
+    inject(*quiet, "MOC:roVariable\n");
+    prompt.update();
+    TEST_ASSERT_EQUAL(2, replies(*chatty));
+    TEST_ASSERT_EQUAL(1, replies(*quiet));
+    TEST_ASSERT_FALSE(prompt.is_idle());
+
+    size_t chatty_replies = 0;
+    for (size_t i = 0; i < 5; ++i) {
+        prompt.update();
+        chatty_replies += replies(*chatty);
+    }
+    TEST_ASSERT_EQUAL(8, chatty_replies);
+    TEST_ASSERT_TRUE(prompt.is_idle());
+
+    // replies go out on the link the request arrived on, as does a switch of dialect
+    inject(*quiet, "Prompt:binary\n");
+    prompt.update();
+    TEST_ASSERT_EQUAL(0, replies(*chatty));
+    TEST_ASSERT_EQUAL(1, replies(*quiet));
+    inject(*chatty, "MOC:roVariable\n");
+    prompt.update();
+    TEST_ASSERT_EQUAL(1, replies(*chatty));
+
+    // unsolicited messages are published on every link
+    TEST_ASSERT(prompt.publish("MOC", 1, 16, [](ReplyWriter& reply) { reply.write("row"); }));
+    prompt.update();
+    TEST_ASSERT_EQUAL(1, replies(*chatty));
+    TEST_ASSERT(quiet->extract_bytestream());
+    // hotloading a datalink replaces every link
+    auto replacement = make_stream();
+    prompt.hotload_datalink(std::make_shared<Datalink>(replacement, g_dl_cfg));
+    inject(*chatty, "MOC:roVariable\n");
+    inject(*replacement, "MOC:roVariable\n");
+    prompt.update();
+    TEST_ASSERT_EQUAL(0, replies(*chatty));
+    TEST_ASSERT_EQUAL(1, replies(*replacement));
+}
+
+void ut_prompt_test_rate_limit() {
+    auto ms = std::make_shared<MockStream>(
+        MockStream::Config{.input_buffer_size = g_ms_io_buffer_size, .output_buffer_size = g_ms_io_buffer_size});
+    ms->initialize();
+    auto prompt = Prompt(
+        Prompt::Config{.io_buffer_size = g_ms_io_buffer_size, .rate_limit_burst = 4, .rate_limit_per_s = 10});
+    prompt.add_datalink(std::make_shared<Datalink>(ms, g_dl_cfg));
+    size_t calls = 0;
+    const auto call = [&calls](const OptStringView&) {
+        ++calls;
+        return RPCResult(RPCResult::Status::OK);
+    };
+    prompt.hotload_rpc_recipe(std::make_unique<RPCRecipe>(RPCRecipe(
+        "RTL", {
+                   RPCModel("safety", call, "", RPCModel::CachePolicy::none(), RPCModel::Priority::SAFETY),
+                   RPCModel("normal", call),
+                   RPCModel("bulk", call, "", RPCModel::CachePolicy::none(), RPCModel::Priority::BULK),
+               })));
+    prompt.initialize();
+    const auto exchange = [&ms, &prompt](const std::string& request) {
+        ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+        prompt.update();
+        const auto reply = ms->extract_bytestream();
+        return reply ? std::string(reply->begin(), reply->end()) : std::string();
+    };
+
+    // bulk requests are rejected once the bucket is less than half full, normal requests once it is empty
+    TEST_ASSERT_EQUAL_STRING("RTL<OK\r\nRTL<OK\r\nRTL<OK\r\nRTL<BUSY\r\n",
+                             exchange("RTL:bulk\nRTL:bulk\nRTL:bulk\nRTL:bulk\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("RTL<OK\r\nRTL<BUSY\r\n", exchange("RTL:normal\nRTL:normal\n").c_str());
+    TEST_ASSERT_EQUAL(4, calls);
+
+    // safety requests are never rejected
+    TEST_ASSERT_EQUAL_STRING("RTL<OK\r\nRTL<OK\r\n", exchange("RTL:safety\nRTL:safety\n").c_str());
+    TEST_ASSERT_EQUAL(6, calls);
+
+    // the bucket refills over time
+    HAL::delay(k_time_ms(120));
+    TEST_ASSERT_EQUAL_STRING("RTL<OK\r\nRTL<BUSY\r\n", exchange("RTL:normal\nRTL:normal\n").c_str());
+    TEST_ASSERT_EQUAL(7, calls);
+}
+
+void ut_prompt_test_rate_limit_small_bursts() {
+    // a bulk request is admitted while the bucket is at least half full, the token it takes included
+    for (const size_t burst : {1, 2, 3, 4, 32}) {
+        auto ms = std::make_shared<MockStream>(
+            MockStream::Config{.input_buffer_size = g_ms_io_buffer_size, .output_buffer_size = g_ms_io_buffer_size});
+        ms->initialize();
+        auto prompt = Prompt(
+            Prompt::Config{.io_buffer_size = g_ms_io_buffer_size, .rate_limit_burst = burst, .rate_limit_per_s = 1});
+        prompt.add_datalink(std::make_shared<Datalink>(ms, g_dl_cfg));
+        size_t calls = 0;
+        prompt.hotload_rpc_recipe(std::make_unique<RPCRecipe>(RPCRecipe(
+            "RTL", {
+                       RPCModel(
+                           "bulk",
+                           [&calls](const OptStringView&) {
+                               ++calls;
+                               return RPCResult(RPCResult::Status::OK);
+                           },
+                           "", RPCModel::CachePolicy::none(), RPCModel::Priority::BULK),
+                   })));
+        prompt.initialize();
+
+        for (size_t i = 0; i < burst + 1; ++i) {
+            const auto request = std::string("RTL:bulk\n");
+            ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+            prompt.update();
+            ms->extract_bytestream();
+        }
+        TEST_ASSERT_EQUAL(burst / 2 + 1, calls);
+    }
+}
+
+void ut_prompt_test_typed_arguments() {
+    enum class Spectrum { BROAD, VIOLET };
+    g_prompt->hotload_rpc_recipe(std::make_unique<RPCRecipe>(RPCRecipe(
+        "TYP", {
+                   RPCModel::typed("scale",
+                                   [](float value, int factor) { return RPCResult(std::to_string(value * factor)); }),
+                   RPCModel::typed("lights",
+                                   [](Spectrum spectrum, std::optional<k_time_ms> duration) {
+                                       return RPCResult(std::string(magic_enum::enum_name(spectrum)) + "|"
+                                                        + std::to_string(duration ? duration->raw() : 0));
+                                   }),
+                   RPCModel::typed("flag", [](bool flag) { return RPCResult(flag ? "yes" : "no"); }),
+                   RPCModel::typed("none", []() { return RPCResult(RPCResult::Status::OK); }),
+               })));
+    const auto exchange = [](const std::string& request) {
+        g_ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+        g_prompt->update();
+        const auto reply = g_ms->extract_bytestream();
+        return reply ? std::string(reply->begin(), reply->end()) : std::string();
+    };
+
+    // arguments are separated by `VALUE_SEPARATOR` and parsed into the parameters' types
+    TEST_ASSERT_EQUAL_STRING("TYP<OK:3.000000\r\n", exchange("TYP:scale:1.5|2\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("TYP<OK:VIOLET|0\r\n", exchange("TYP:lights:VIOLET\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("TYP<OK:BROAD|2000\r\n", exchange("TYP:lights:BROAD|2s\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("TYP<OK:yes\r\n", exchange("TYP:flag:true\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("TYP<OK\r\n", exchange("TYP:none\n").c_str());
+
+    // missing, malformed and surplus arguments are uniformly rejected without invoking the procedure
+    for (const auto request : {"TYP:scale\n", "TYP:scale:1.5\n", "TYP:scale:1.5|2|3\n", "TYP:scale:1.5x|2\n",
+                               "TYP:scale:1.5|2.5\n", "TYP:scale:nan|2\n", "TYP:lights:RED\n",
+                               "TYP:lights:BROAD|2 parsecs\n", "TYP:flag:maybe\n", "TYP:none:1\n"}) {
+        TEST_ASSERT_EQUAL_STRING_MESSAGE("TYP<BAD_INPUT\r\n", exchange(request).c_str(), request);
+    }
+}
+
+void ut_prompt_test_stats() {
+    const auto exchange = [](const std::string& request) {
+        g_ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+        g_prompt->update();
+        const auto reply = g_ms->extract_bytestream();
+        return reply ? std::string(reply->begin(), reply->end()) : std::string();
+    };
+    const auto stats_line = [](const std::string& stats, const std::string& command) {
+        const auto begin = stats.find(command + "|");
+        if (begin == std::string::npos) return std::string();
+        return stats.substr(begin, stats.find_first_of(std::string(Dialect::RECORD_SEPARATOR) + "\r", begin) - begin);
+    };
+    const auto field = [](const std::string& line, size_t index) {
+        size_t begin = 0;
+        for (size_t i = 0; i < index; ++i)
+            begin = line.find('|', begin) + 1;
+        return std::stoul(line.substr(begin, line.find('|', begin) - begin));
+    };
+
+    // every call is counted with its errors, execution time and the bytes of its reply
+    TEST_ASSERT_EQUAL_STRING("MOC<OK:42.000000\r\n", exchange("MOC:roVariable\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("MOC<OK:42.000000\r\n", exchange("MOC:roVariable\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("MOC<BAD_INPUT\r\n", exchange("MOC:foo\n").c_str());
+    exchange("?\n");
+    const auto stats = exchange("Prompt:stats\n");
+    TEST_ASSERT_EQUAL(0, stats.find("Prompt<OK:"));
+    TEST_ASSERT_EQUAL(stats.size() - 2, stats.find_first_of("\r\n")); // a single line, records separated by ','
+
+    const auto ro_variable = stats_line(stats, "MOC:roVariable");
+    TEST_ASSERT_EQUAL(2, field(ro_variable, 1)); // calls
+    TEST_ASSERT_EQUAL(0, field(ro_variable, 2)); // errors
+    TEST_ASSERT(field(ro_variable, 3) <= field(ro_variable, 4)); // min <= mean
+    TEST_ASSERT(field(ro_variable, 4) <= field(ro_variable, 5)); // mean <= max
+    TEST_ASSERT_EQUAL(2 * std::strlen("MOC<OK:42.000000\r\n"), field(ro_variable, 6));
+    const auto foo = stats_line(stats, "MOC:foo");
+    TEST_ASSERT_EQUAL(1, field(foo, 1));
+    TEST_ASSERT_EQUAL(1, field(foo, 2));
+    TEST_ASSERT(stats_line(stats, "MOC:rwVariable").empty()); // never called
+    TEST_ASSERT_EQUAL(1, field(stats_line(stats, "?"), 1)); // the usage listing, which is in no recipe
+
+    // a reset clears every model's metrics
+    TEST_ASSERT_EQUAL_STRING("Prompt<OK\r\n", exchange("Prompt:stats:reset\n").c_str());
+    const auto after_reset = exchange("Prompt:stats\n");
+    TEST_ASSERT(stats_line(after_reset, "MOC:roVariable").empty());
+    TEST_ASSERT_EQUAL(1, field(stats_line(after_reset, "Prompt:stats"), 1)); // the reset itself
+    TEST_ASSERT_EQUAL_STRING("Prompt<BAD_INPUT\r\n", exchange("Prompt:stats:bogus\n").c_str());
+}
+
+/// test that a line dribbled in a byte at a time is read once its delimiter arrives, and that lines arriving together
+/// are all read
+void ut_prompt_test_dribbled_line() {
+    const auto line = std::string("?foo");
+    for (const auto c : line + "\r") {
+        g_ms->inject_bytestream({static_cast<uint8_t>(c)});
+        TEST_ASSERT_EQUAL(1, g_dl->pull());
+        const auto transaction = g_dl->read_line();
+        TEST_ASSERT_EQUAL(c == '\r', transaction.has_value());
+        if (transaction) TEST_ASSERT_EQUAL_STRING(line.c_str(), std::string(transaction->incoming()).c_str());
+    }
+    // the LF completes no line of its own
+    g_ms->inject_bytestream({'\n'});
+    TEST_ASSERT_EQUAL(1, g_dl->pull());
+    auto empty = g_dl->read_line();
+    TEST_ASSERT(!empty || empty->incoming().empty());
+    empty.reset();
+
+    const auto burst = std::string("?a\n?bb\n?ccc\n");
+    g_ms->inject_bytestream(std::vector<uint8_t>(burst.begin(), burst.end()));
+    g_dl->pull();
+    for (const auto* expected : {"?a", "?bb", "?ccc"}) {
+        const auto transaction = g_dl->read_line();
+        TEST_ASSERT(transaction.has_value());
+        TEST_ASSERT_EQUAL_STRING(expected, std::string(transaction->incoming()).c_str());
+    }
+    TEST_ASSERT(!g_dl->read_line());
+}
+
+void ut_prompt_test_held_bytes() {
+    using kaskas::core::AllocationTracker;
+    auto ms = std::make_shared<MockStream>(
+        MockStream::Config{.input_buffer_size = g_ms_io_buffer_size, .output_buffer_size = g_ms_io_buffer_size});
+    auto scanner = detail::DelimiterCountingStream(ms, "\r\n", g_ms_io_buffer_size);
+    const auto inject = [&ms](const std::string& bytes) {
+        ms->inject_bytestream(std::vector<uint8_t>(bytes.begin(), bytes.end()));
+    };
+    auto buffer = std::array<uint8_t, detail::DelimiterCountingStream::max_read_size>{};
+    const auto read = [&scanner, &buffer]() {
+        const auto bytes = scanner.read(buffer.data(), buffer.size());
+        return std::string(buffer.begin(), buffer.begin() + bytes);
+    };
+
+    // the line following the one passed on is held, and is available though the stream holds nothing
+    inject("?a\n?bb\n");
+    TEST_ASSERT_EQUAL_STRING("?a\n", read().c_str());
+    TEST_ASSERT_EQUAL(0, ms->available());
+    TEST_ASSERT_EQUAL(4, scanner.available());
+    TEST_ASSERT_EQUAL_STRING("?bb\n", read().c_str());
+    TEST_ASSERT_EQUAL(0, scanner.available());
+    TEST_ASSERT_EQUAL(2, scanner.delimiters());
+
+    // lines of every length wrap the ring of held bytes around, without allocating
+    auto burst = std::string();
+    for (size_t i = 0; burst.size() < g_ms_io_buffer_size - 16; ++i)
+        burst += "?" + std::string(i % 13, 'x') + "\n";
+    inject(burst);
+    auto lines = std::string();
+    lines.reserve(burst.size());
+    const auto allocations = AllocationTracker::total().allocations;
+    while (scanner.available() > 0) {
+        const auto bytes = scanner.read(buffer.data(), buffer.size());
+        TEST_ASSERT_GREATER_THAN(0, bytes);
+        lines.append(buffer.begin(), buffer.begin() + bytes);
+    }
+    if (AllocationTracker::is_enabled) TEST_ASSERT_EQUAL(allocations, AllocationTracker::total().allocations);
+    TEST_ASSERT_EQUAL_STRING(burst.c_str(), lines.c_str());
+}
+
+/// test that a request ID is parsed in front of the module only, and is echoed in front of every reply
+void ut_prompt_test_request_id() {
+    const auto usage = IncomingMessageFactory::from_view("4#?");
+    TEST_ASSERT(usage && usage->operant == Dialect::OPERANT_PRINT_USAGE && usage->request_id == "4");
+    const auto without_id = IncomingMessageFactory::from_view("MOC:foo:1#2");
+    TEST_ASSERT(without_id && !without_id->request_id && without_id->arguments == "1#2");
+    const auto too_long = IncomingMessageFactory::from_view("123456789#MOC:foo");
+    TEST_ASSERT(too_long.is_failed());
+    TEST_ASSERT(too_long.unwrap_error_value() == IncomingMessageFactory::Error::MALFORMED_REQUEST_ID);
+
+    const auto reply = OutgoingMessageFactory::from_rpc_result(RPCResult("1"), "MOD", std::string_view("x_1"));
+    TEST_ASSERT(reply);
+    TEST_ASSERT_EQUAL_STRING("x_1#MOD<OK:1", reply->as_string().c_str());
+
+    const auto exchange = [](const std::string& request) {
+        g_ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+        g_prompt->update();
+        auto replies = std::string();
+        if (const auto reply = g_ms->extract_bytestream()) replies.append(reply->begin(), reply->end());
+        return replies;
+    };
+
+    // pipelined requests to the same module are told apart by their IDs
+    TEST_ASSERT_EQUAL_STRING("1#MOC<OK:42.000000\r\n2#MOC<OK:3.000000\r\n",
+                             exchange("1#MOC:roVariable\n2#MOC:foo:3\n").c_str());
+
+    // the requests of a batch carry their own IDs, or none; errors echo the ID as well
+    TEST_ASSERT_EQUAL_STRING("a#MOC<OK:42.000;MOC<OK:42.000000;b#BAD_MESSAGE<UNKNOWN_RECIPE\r\n",
+                             exchange("a#MOC:roVariableWriter;MOC:roVariable;b#FOO:bar\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("3#BAD_MESSAGE<MALFORMED_MODULE\r\n", exchange("3#:::\n").c_str());
+
+    // an invalid ID is not echoed
+    TEST_ASSERT_EQUAL_STRING("BAD_MESSAGE<MALFORMED_REQUEST_ID\r\n", exchange("#MOC:roVariable\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("BAD_MESSAGE<MALFORMED_REQUEST_ID\r\n", exchange("a b#MOC:roVariable\n").c_str());
+}
+
+/// test that compressed values decompress to their plain value, and that a link opted in to compression streams its
+/// replies compressed
+void ut_prompt_test_compression() {
+    namespace lz = compression;
+    const auto round_trip = [](const std::string& value, size_t fragment_size) {
+        auto encoder = lz::Encoder();
+        auto encoded = std::string();
+        const auto sink = [&encoded](const std::string_view& bytes) { encoded.append(bytes); };
+        for (size_t i = 0; i < value.size(); i += fragment_size)
+            encoder.put(std::string_view(value).substr(i, fragment_size), sink);
+        encoder.finish(sink);
+        TEST_ASSERT(encoded.size() <= lz::max_encoded_size(value.size()));
+        // copies and their distances are never delimiters: only the literal delimiters of the value remain
+        TEST_ASSERT(std::count(encoded.begin(), encoded.end(), '\n') <= std::count(value.begin(), value.end(), '\n'));
+
+        auto decoded = std::string(value.size(), '\0');
+        const auto size = lz::decode(encoded, decoded.data(), decoded.size());
+        TEST_ASSERT(size && *size == value.size());
+        TEST_ASSERT(decoded == value);
+        return encoded.size();
+    };
+
+    auto repetitive = std::string();
+    for (size_t i = 0; i < 200; ++i)
+        repetitive += "21.50|" + std::to_string(40 + i % 7) + ".00|1|\n";
+    auto noise = std::string();
+    uint32_t state = 0x2545F491;
+    for (size_t i = 0; i < 2000; ++i) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        noise += static_cast<char>(state);
+    }
+    for (const auto fragment_size : {size_t(1), size_t(7), size_t(80), size_t(4096)}) {
+        TEST_ASSERT_EQUAL(0, round_trip("", fragment_size));
+        TEST_ASSERT(round_trip(repetitive, fragment_size) * 4 < repetitive.size());
+        TEST_ASSERT(round_trip(std::string(1000, 'a'), fragment_size) < 40);
+        round_trip(noise, fragment_size);
+    }
+
+    // malformed input is rejected, as is output that does not fit
+    char out[8];
+    TEST_ASSERT(!lz::decode("\x80\x80", out, sizeof(out))); // a copy from before the start
+    TEST_ASSERT(!lz::decode("a\xff", out, sizeof(out))); // a truncated literal
+    TEST_ASSERT(!lz::decode("a\xbe\x80", out, sizeof(out))); // an invalid code
+    TEST_ASSERT(!lz::decode("a\xbd\x80", out, sizeof(out))); // a copy that does not fit
+    TEST_ASSERT_EQUAL(6, *lz::decode("ab\x81\x81", out, sizeof(out)));
+    TEST_ASSERT(std::string_view(out, 6) == "ababab");
+
+    const auto exchange = [](const std::string& request) {
+        g_ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+        auto replies = std::string();
+        for (size_t updates = 0; updates < 20 && (updates == 0 || !g_prompt->is_idle()); ++updates) {
+            g_prompt->update();
+            if (const auto reply = g_ms->extract_bytestream()) replies.append(reply->begin(), reply->end());
+        }
+        return replies;
+    };
+    const auto decompress = [](const std::string& reply, const std::string& header) {
+        TEST_ASSERT_EQUAL_STRING(header.c_str(), reply.substr(0, header.size()).c_str());
+        const auto encoded = std::string_view(reply).substr(header.size(), reply.size() - header.size() - 2);
+        auto value = std::string(8 * g_ms_io_buffer_size, '\0');
+        const auto size = lz::decode(encoded, value.data(), value.size());
+        TEST_ASSERT(size);
+        value.resize(*size);
+        return value;
+    };
+
+    // the acknowledgement is not compressed yet; the replies that follow are
+    const auto plain_usage = exchange("?\n");
+    TEST_ASSERT_EQUAL_STRING("Prompt<OK\r\n", exchange("Prompt:compress:1\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("42.000000", decompress(exchange("MOC:roVariable\n"), "MOC<OK~").c_str());
+    TEST_ASSERT_EQUAL_STRING("MOC<BAD_INPUT\r\n", exchange("MOC:foo\n").c_str());
+
+    // a streamed reply is compressed as it is streamed
+    const auto usage = exchange("?\n");
+    const auto header = plain_usage.substr(0, plain_usage.find(Dialect::KV_SEPARATOR) + 1);
+    TEST_ASSERT(usage.size() < plain_usage.size());
+    TEST_ASSERT_EQUAL_STRING(plain_usage.substr(header.size(), plain_usage.size() - header.size() - 2).c_str(),
+                             decompress(usage, header.substr(0, header.size() - 1) + "~").c_str());
+
+    TEST_ASSERT_EQUAL_STRING("Prompt<OK\r\n", exchange("Prompt:compress:0\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("MOC<OK:42.000000\r\n", exchange("MOC:roVariable\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("Prompt<BAD_INPUT\r\n", exchange("Prompt:compress:yes\n").c_str());
+}
+
+void ut_prompt_test_soak() {
+    using kaskas::core::AllocationTracker;
+    const auto live_allocations = [] {
+        const auto& total = AllocationTracker::total();
+        return total.allocations - total.deallocations;
+    };
+
+    auto ms = std::make_shared<MockStream>(
+        MockStream::Config{.input_buffer_size = g_ms_io_buffer_size, .output_buffer_size = g_ms_io_buffer_size});
+    ms->initialize();
+    auto dl = std::make_shared<Datalink>(ms, g_dl_cfg);
+    auto prompt = Prompt(Prompt::Config{.io_buffer_size = g_ms_io_buffer_size, .rate_limit_per_s = 0});
+    prompt.add_datalink(dl);
+    prompt.hotload_rpc_recipe(std::make_unique<RPCRecipe>(RPCRecipe(
+        "SOK", {
+                   RPCModel("result", [](const OptStringView& s) { return RPCResult(std::string(s.value_or("1"))); }),
+                   RPCModel("writer", [](const OptStringView&, ReplyWriter& reply) { reply.write(42.0f, 3); }),
+               })));
+    prompt.initialize();
+
+    // a million requests where allocations are tracked; the sanitized build only exercises the pools
+    const size_t soak_requests = AllocationTracker::is_enabled ? 1000000 : 10000;
+    const size_t warm_up = 1000; // such as the reply cache and the buffers of the mock stream
+    const auto requests = std::array<std::string, 3>{"SOK:result\n", "7#SOK:result:2\n", "SOK:writer\n"};
+    const auto inject = [&ms](const std::string& request) {
+        ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+    };
+
+    // once warmed up, the prompt leaves the heap as it found it
+    size_t live = 0;
+    for (size_t i = 0; i < soak_requests; ++i) {
+        if (i == warm_up) live = live_allocations();
+        inject(requests[i % requests.size()]);
+        prompt.update();
+        TEST_ASSERT(ms->extract_bytestream());
+    }
+    if (AllocationTracker::is_enabled) TEST_ASSERT_EQUAL(live, live_allocations());
+
+    // so does the message API, which stores its messages in the pools of the datalink
+    for (size_t i = 0; i < soak_requests / 10; ++i) {
+        if (i == warm_up) live = live_allocations();
+        inject(requests[i % requests.size()]);
+        dl->pull();
+        const auto message = dl->read_message();
+        TEST_ASSERT(message);
+        const auto reply = OutgoingMessageFactory::from_rpc_result(RPCResult("42"), message->module,
+                                                                   message->request_id, &dl->result_pool());
+        TEST_ASSERT(reply);
+        dl->write_message(*reply);
+        dl->push();
+        TEST_ASSERT(ms->extract_bytestream());
+    }
+    if (AllocationTracker::is_enabled) TEST_ASSERT_EQUAL(live, live_allocations());
+    TEST_ASSERT_EQUAL(0, dl->message_pool().overflows());
+    TEST_ASSERT_EQUAL(0, dl->result_pool().overflows());
+    TEST_ASSERT_EQUAL(1, dl->message_pool().high_water());
+
+    // beyond its capacity a pool falls back to the heap
+    auto pool = kaskas::core::ObjectPool<RPCResult>(1);
+    {
+        const auto first = pool.acquire(RPCResult("1"));
+        const auto second = pool.acquire(RPCResult("2"));
+        TEST_ASSERT_EQUAL(1, pool.in_use());
+        TEST_ASSERT_EQUAL(1, pool.overflows());
+        TEST_ASSERT_EQUAL_STRING("2", second->return_value->c_str());
+    }
+    TEST_ASSERT_EQUAL(0, pool.in_use());
+}
+
 /// test if repeat use of the prompt with erroneous input leads to memory corruption (fsanitize must be enabled)
 // void ut_prompt_stress_testing() {
 //     using namespace kaskas::prompt;
@@ -336,9 +1783,36 @@ int run_all_tests() {
     UNITY_BEGIN();
     RUN_TEST(ut_prompt_test_datalink);
     RUN_TEST(ut_prompt_test_incoming_message_factory);
+    RUN_TEST(ut_prompt_test_incoming_message_factory_fuzz);
     RUN_TEST(ut_prompt_test_outgoing_message_factory);
     RUN_TEST(ut_prompt_test_rpc_factory);
+    RUN_TEST(ut_prompt_test_perfect_hash_table);
     RUN_TEST(ut_prompt_test_integration);
+    RUN_TEST(ut_prompt_test_reply_writer);
+    RUN_TEST(ut_prompt_test_pipelined_burst);
+    RUN_TEST(ut_prompt_test_batch);
+    RUN_TEST(ut_prompt_test_binary_mode);
+    RUN_TEST(ut_prompt_test_publish);
+    RUN_TEST(ut_prompt_test_tickets);
+    RUN_TEST(ut_prompt_test_tickets_served_while_blocked);
+    RUN_TEST(ut_prompt_test_streamed_reply);
+    RUN_TEST(ut_prompt_test_allocation_budgets);
+    RUN_TEST(ut_prompt_test_interrupt_stream);
+    RUN_TEST(ut_prompt_test_reply_cache);
+    RUN_TEST(ut_prompt_test_reply_cache_streamed_across_links);
+    RUN_TEST(ut_prompt_test_multiple_datalinks);
+    RUN_TEST(ut_prompt_test_rate_limit);
+    RUN_TEST(ut_prompt_test_rate_limit_small_bursts);
+    RUN_TEST(ut_prompt_test_typed_arguments);
+    RUN_TEST(ut_prompt_test_interrupt_stream_tx);
+    RUN_TEST(ut_prompt_test_stats);
+    RUN_TEST(ut_prompt_test_dribbled_line);
+    RUN_TEST(ut_prompt_test_held_bytes);
+    RUN_TEST(ut_prompt_test_request_id);
+    RUN_TEST(ut_prompt_test_compression);
+    RUN_TEST(ut_prompt_test_baud_negotiation);
+    RUN_TEST(ut_prompt_test_baud_negotiation_with_datalink);
+    RUN_TEST(ut_prompt_test_soak);
     //    RUN_TEST(ut_prompt_basics);
     //    RUN_TEST(ut_prompt_stress_testing);
     return UNITY_END();
@@ -0,0 +1,135 @@
+// Compiles every subsystem natively, so that their RPC recipes and event handlers are checked without a board.
+#include "kaskas/subsystems/climatecontrol.hpp"
+#include "kaskas/subsystems/data_acquisition.hpp"
+#include "kaskas/subsystems/fluidsystem.hpp"
+#include "kaskas/subsystems/growlights.hpp"
+#include "kaskas/subsystems/hardware.hpp"
+#include "kaskas/subsystems/ui.hpp"
+
+#include <spine/io/stream/implementations/mock.hpp>
+#include <unity.h>
+
+#include <algorithm>
+#include <string>
+#include <type_traits>
+
+using namespace kaskas;
+
+void setUp(void) {}
+
+void tearDown(void) {}
+
+void ut_subsystems_are_components() {
+    static_assert(std::is_base_of_v<Component, component::ClimateControl>);
+    static_assert(std::is_base_of_v<Component, component::DataAcquisition>);
+    static_assert(std::is_base_of_v<Component, component::Fluidsystem>);
+    static_assert(std::is_base_of_v<Component, component::Growlights>);
+    static_assert(std::is_base_of_v<Component, component::Hardware>);
+    static_assert(std::is_base_of_v<Component, component::UI>);
+}
+
+void ut_subsystems_hardware_recipe() {
+    auto hws = io::HardwareStack({.alias = "HWS"});
+    auto hardware = component::Hardware(hws, component::Hardware::Config{});
+
+    const auto recipe = hardware.rpc_recipe();
+    TEST_ASSERT(recipe != nullptr);
+    TEST_ASSERT(recipe->module() == "HW");
+    TEST_ASSERT(recipe->find_model_for_command("shutdown"));
+    TEST_ASSERT(recipe->find_model_for_command("allocStats"));
+}
+
+void ut_subsystems_hardware_alloc_stats_reply_is_a_line() {
+    auto ms = std::make_shared<spn::io::MockStream>(
+        spn::io::MockStream::Config{.input_buffer_size = 1024, .output_buffer_size = 1024});
+    ms->initialize();
+    auto prompt = prompt::Prompt({.io_buffer_size = 1024});
+    prompt.add_datalink(std::make_shared<prompt::Datalink>(
+        ms, prompt::Datalink::Config{.input_buffer_size = 1024, .output_buffer_size = 1024, .delimiters = "\r\n"}));
+    auto hws = io::HardwareStack({.alias = "HWS"});
+    auto hardware = component::Hardware(hws, component::Hardware::Config{});
+    prompt.hotload_rpc_recipe(hardware.rpc_recipe());
+    prompt.initialize();
+
+    const auto exchange = [&](const std::string& request) {
+        ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+        for (int i = 0; i < 8; ++i) // the reply is streamed across updates
+            prompt.update();
+        const auto reply = ms->extract_bytestream();
+        return reply ? std::string(reply->begin(), reply->end()) : std::string();
+    };
+
+    exchange("HW:allocStats\n"); // the first call opens the scope of the model itself
+    const auto reply = exchange("HW:allocStats\n");
+    if (!core::AllocationTracker::is_enabled) {
+        TEST_ASSERT_EQUAL(0, reply.find("HW<BAD_RESULT"));
+        return;
+    }
+    TEST_ASSERT_EQUAL(0, reply.find("HW<OK:"));
+    TEST_ASSERT(reply.find("HW:allocStats|") != std::string::npos);
+    TEST_ASSERT(reply.find(std::string(prompt::Dialect::RECORD_SEPARATOR) + "HW:allocStats|") != std::string::npos);
+    // the records share a single line: only the reply's own line break ends it
+    TEST_ASSERT_EQUAL(reply.size() - 2, reply.find_first_of("\r\n"));
+    TEST_ASSERT_EQUAL(1, std::count(reply.begin(), reply.end(), '\n'));
+}
+
+void ut_subsystems_daq_subscribe() {
+    auto ms = std::make_shared<spn::io::MockStream>(
+        spn::io::MockStream::Config{.input_buffer_size = 1024, .output_buffer_size = 1024});
+    ms->initialize();
+    auto prompt = std::make_shared<prompt::Prompt>(prompt::Prompt::Config{.io_buffer_size = 1024});
+    prompt->add_datalink(std::make_shared<prompt::Datalink>(
+        ms, prompt::Datalink::Config{.input_buffer_size = 1024, .output_buffer_size = 1024, .delimiters = "\r\n"}));
+    auto evsys = EventSystem(EventSystem::Config{});
+    auto hws = io::HardwareStack({.alias = "HWS"});
+    const auto cfg = component::DataAcquisition::Config{
+        .active_dataproviders = {DataProviders::CLIMATE_TEMP, DataProviders::SOIL_MOISTURE}};
+    auto daq = component::DataAcquisition(hws, &evsys, cfg);
+    daq.hotload_prompt(prompt);
+    prompt->hotload_rpc_recipe(daq.rpc_recipe());
+    prompt->initialize();
+    daq.handle_event(evsys.event(Events::DAQWarmedUp, k_time_s(0)));
+
+    const auto exchange = [&](const std::string& request) {
+        ms->inject_bytestream(std::vector<uint8_t>(request.begin(), request.end()));
+        prompt->update();
+        const auto reply = ms->extract_bytestream();
+        return reply ? std::string(reply->begin(), reply->end()) : std::string();
+    };
+
+    TEST_ASSERT_EQUAL_STRING("DAQ<OK:CLIMATE_TEMP|SOIL_MOISTURE\r\n", exchange("DAQ:subscribe:1s\n").c_str());
+    TEST_ASSERT_EQUAL_STRING("DAQ<OK:SOIL_MOISTURE\r\n", exchange("DAQ:subscribe:1s|SOIL_MOISTURE\n").c_str());
+    TEST_ASSERT_EQUAL(0, exchange("DAQ:subscribe:1s|CLOCK\n").find("DAQ<BAD_INPUT:Error: Unknown column CLOCK"));
+
+    // a column list selecting no columns at all is refused, rather than publishing empty rows
+    TEST_ASSERT_EQUAL(0, exchange("DAQ:subscribe:1s|\n").find("DAQ<BAD_INPUT:Error: No columns selected."));
+}
+
+int run_all_tests() {
+    UNITY_BEGIN();
+    RUN_TEST(ut_subsystems_are_components);
+    RUN_TEST(ut_subsystems_hardware_recipe);
+    RUN_TEST(ut_subsystems_hardware_alloc_stats_reply_is_a_line);
+    RUN_TEST(ut_subsystems_daq_subscribe);
+    return UNITY_END();
+}
+
+#if defined(ARDUINO) && defined(EMBEDDED)
+#    include <Arduino.h>
+void setup() {
+    // NOTE!!! Wait for >2 secs
+    // if board doesn't support software reset via Serial.DTR/RTS
+    delay(2000);
+
+    run_all_tests();
+}
+
+void loop() {}
+#elif defined(ARDUINO)
+#    include <ArduinoFake.h>
+#endif
+
+int main(int argc, char** argv) {
+    run_all_tests();
+    return 0;
+}